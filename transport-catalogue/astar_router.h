@@ -0,0 +1,115 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "shortest_path_tree.h"
+
+#include <algorithm>
+#include <functional>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Поиск маршрута по запросу алгоритмом A*: вершины извлекаются из очереди в порядке
+// вес от начала + оценка heuristic(vertex, to) веса оставшегося пути.
+// Оценка должна быть допустимой (не больше настоящего веса), тогда найденный маршрут кратчайший,
+// а вершины в стороне от цели просматриваются реже, чем в алгоритме Дейкстры.
+// Граф должен быть заморожен.
+template <typename Weight, typename Heuristic>
+class AStarRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    AStarRouter(const Graph& graph, Heuristic heuristic);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Для нескольких вершин оценка не помогает: одно дерево кратчайших путей из from
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override {
+        if (targets.size() < 2) {
+            return BaseRouter<Weight>::BuildRoutes(from, targets);
+        }
+        return BuildTreeRoutes(graph_, from, targets);
+    }
+
+private:
+    // Приоритет, вес от начала и вершина
+    using QueueItem = std::tuple<Weight, Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = InfiniteWeight<Weight>();
+    const Graph& graph_;
+    Heuristic heuristic_;
+};
+
+template <typename Weight, typename Heuristic>
+AStarRouter<Weight, Heuristic>::AStarRouter(const Graph& graph, Heuristic heuristic)
+    : graph_(graph)
+    , heuristic_(std::move(heuristic))
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building AStarRouter");
+    }
+    if (graph.HasNegativeWeights()) {
+        throw std::domain_error("Edges' weights should be non-negative");
+    }
+}
+
+template <typename Weight, typename Heuristic>
+std::optional<typename AStarRouter<Weight, Heuristic>::RouteInfo>
+AStarRouter<Weight, Heuristic>::BuildRoute(VertexId from, VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    std::vector<Weight> weights(graph_.GetVertexCount(), INFINITE_WEIGHT);
+    std::vector<std::optional<EdgeId>> prev_edges(graph_.GetVertexCount());
+    Queue queue;
+    weights[from] = ZERO_WEIGHT;
+    queue.push({heuristic_(from, to), ZERO_WEIGHT, from});
+
+    while (!queue.empty()) {
+        const auto [priority, weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue;
+        }
+        // С допустимой оценкой первый извлеченный из очереди путь до цели - кратчайший
+        if (vertex == to) {
+            break;
+        }
+        for (const auto& arc : graph_.GetIncidentArcs(vertex)) {
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < weights[arc.vertex]) {
+                weights[arc.vertex] = candidate_weight;
+                prev_edges[arc.vertex] = arc.edge_id;
+                queue.push({candidate_weight + heuristic_(arc.vertex, to), candidate_weight, arc.vertex});
+            }
+        }
+    }
+
+    if (weights[to] == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = prev_edges[to];
+         edge_id;
+         edge_id = prev_edges[graph_.GetEdge(*edge_id).from])
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return RouteInfo{weights[to], std::move(edges)};
+}
+
+}  // namespace graph
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+#include "shortest_path_tree.h"
+
+#include <algorithm>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизатор, который строит полное дерево кратчайших путей для каждой начальной вершины
+// и хранит последние использованные деревья в LRU-кэше ограниченного объема.
+// Повторный запрос из той же вершины восстанавливает путь за O(длины маршрута).
+template <typename Weight>
+class CachedTreeRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Tree = ShortestPathTree<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    struct CacheStats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t evictions = 0;
+        size_t invalidations = 0;
+        size_t cached_trees = 0;
+        size_t capacity = 0;
+    };
+
+    // memory_limit - ограничение памяти кэша в байтах, в кэше всегда помещается хотя бы одно дерево
+    CachedTreeRouter(const Graph& graph, size_t memory_limit);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    [[nodiscard]] CacheStats GetStats() const;
+
+    // Удаляет из кэша деревья, в которых новые ребра графа могут сократить хотя бы один путь.
+    // Граф к этому моменту должен быть снова заморожен
+    void AddEdges(const std::vector<EdgeId>& edge_ids);
+
+private:
+    using TreePtr = std::shared_ptr<const Tree>;
+    using LruList = std::list<std::pair<VertexId, TreePtr>>;
+
+    TreePtr FindTree(VertexId from) const;
+
+    const Graph& graph_;
+    size_t capacity_;
+
+    mutable std::mutex mutex_;
+    mutable LruList lru_;
+    mutable std::unordered_map<VertexId, typename LruList::iterator> trees_;
+    mutable CacheStats stats_;
+};
+
+template <typename Weight>
+CachedTreeRouter<Weight>::CachedTreeRouter(const Graph& graph, size_t memory_limit)
+    : graph_(graph)
+    , capacity_(std::max<size_t>(1, memory_limit / Tree::EstimateMemory(graph.GetVertexCount())))
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building CachedTreeRouter");
+    }
+    if (graph.HasNegativeWeights()) {
+        throw std::domain_error("Edges' weights should be non-negative");
+    }
+    stats_.capacity = capacity_;
+}
+
+template <typename Weight>
+std::optional<typename CachedTreeRouter<Weight>::RouteInfo> CachedTreeRouter<Weight>::BuildRoute(VertexId from,
+                                                                                                 VertexId to) const {
+    if (to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const TreePtr tree = FindTree(from);
+    return ExtractRoute(*tree, graph_, to);
+}
+
+template <typename Weight>
+typename CachedTreeRouter<Weight>::CacheStats CachedTreeRouter<Weight>::GetStats() const {
+    std::lock_guard guard(mutex_);
+    return stats_;
+}
+
+template <typename Weight>
+void CachedTreeRouter<Weight>::AddEdges(const std::vector<EdgeId>& edge_ids) {
+    for (const EdgeId edge_id : edge_ids) {
+        if (graph_.GetEdge(edge_id).weight < Weight{}) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+    }
+
+    std::lock_guard guard(mutex_);
+    for (auto it = lru_.begin(); it != lru_.end();) {
+        const Tree& tree = *it->second;
+        const bool is_affected = std::any_of(edge_ids.begin(), edge_ids.end(), [&](EdgeId edge_id) {
+            const auto& edge = graph_.GetEdge(edge_id);
+            return tree.IsReachable(edge.from) && tree.weights[edge.from] + edge.weight < tree.weights[edge.to];
+        });
+        if (is_affected) {
+            trees_.erase(it->first);
+            it = lru_.erase(it);
+            ++stats_.invalidations;
+        } else {
+            ++it;
+        }
+    }
+    stats_.cached_trees = lru_.size();
+}
+
+template <typename Weight>
+typename CachedTreeRouter<Weight>::TreePtr CachedTreeRouter<Weight>::FindTree(VertexId from) const {
+    {
+        std::lock_guard guard(mutex_);
+        if (const auto it = trees_.find(from); it != trees_.end()) {
+            ++stats_.hits;
+            lru_.splice(lru_.begin(), lru_, it->second);
+            return it->second->second;
+        }
+        ++stats_.misses;
+    }
+
+    // Дерево строится без блокировки, чтобы промахи из разных потоков не ждали друг друга
+    TreePtr tree = std::make_shared<const Tree>(BuildShortestPathTree(graph_, from));
+
+    std::lock_guard guard(mutex_);
+    if (trees_.count(from) == 0) {
+        lru_.emplace_front(from, tree);
+        trees_[from] = lru_.begin();
+        while (lru_.size() > capacity_) {
+            trees_.erase(lru_.back().first);
+            lru_.pop_back();
+            ++stats_.evictions;
+        }
+        stats_.cached_trees = lru_.size();
+    }
+    return tree;
+}
+
+}  // namespace graph
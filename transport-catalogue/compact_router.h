@@ -0,0 +1,166 @@
+#pragma once
+
+#include "graph.h"
+#include "parallel.h"
+#include "router.h"
+#include "shortest_path_tree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Предподсчет маршрутов только между терминальными вершинами (для TransportRouter - остановками).
+// Для каждой пары хранится ячейка из 8 байт: вес во float и последнее ребро маршрута,
+// вместо optional используются сигнальные значения. Вся таблица - один непрерывный массив.
+// Промежуточные нетерминальные вершины должны иметь не больше одного входящего ребра:
+// тогда путь через них однозначно восстанавливается по графу.
+template <typename Weight>
+class CompactRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    static constexpr float INFINITE_WEIGHT = std::numeric_limits<float>::infinity();
+
+    struct Cell {
+        float weight = INFINITE_WEIGHT;
+        EdgeId prev_edge = NO_EDGE;
+    };
+
+    CompactRouter(const Graph& graph, const std::vector<VertexId>& terminals);
+    // Маршрутизатор поверх готовой таблицы terminals x terminals, например отображенной в память из файла.
+    // Таблица не копируется и должна пережить маршрутизатор
+    CompactRouter(const Graph& graph, const std::vector<VertexId>& terminals, const Cell* table);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    [[nodiscard]] const Cell* GetTable() const {
+        return table_;
+    }
+    [[nodiscard]] size_t GetTableSize() const {
+        return terminal_count_ * terminal_count_;
+    }
+
+    // Объем таблицы в байтах
+    [[nodiscard]] size_t GetTableMemory() const {
+        return GetTableSize() * sizeof(Cell);
+    }
+
+private:
+    static constexpr uint32_t NOT_TERMINAL = std::numeric_limits<uint32_t>::max();
+
+    void IndexTerminals(const std::vector<VertexId>& terminals);
+
+    size_t Index(uint32_t from, uint32_t to) const {
+        return static_cast<size_t>(from) * terminal_count_ + to;
+    }
+
+    uint32_t TerminalIndex(VertexId vertex) const {
+        if (vertex >= terminal_indices_.size()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        if (terminal_indices_[vertex] == NOT_TERMINAL) {
+            throw std::invalid_argument("Vertex is not a terminal of the compact table");
+        }
+        return terminal_indices_[vertex];
+    }
+
+    const Graph& graph_;
+    size_t terminal_count_;
+    std::vector<uint32_t> terminal_indices_;
+    std::vector<Cell> cells_;
+    const Cell* table_ = nullptr;
+};
+
+template <typename Weight>
+CompactRouter<Weight>::CompactRouter(const Graph& graph, const std::vector<VertexId>& terminals)
+    : graph_(graph)
+    , terminal_count_(terminals.size())
+    , terminal_indices_(graph.GetVertexCount(), NOT_TERMINAL)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building CompactRouter");
+    }
+    if (graph.HasNegativeWeights()) {
+        throw std::domain_error("Edges' weights should be non-negative");
+    }
+    IndexTerminals(terminals);
+
+    cells_.resize(GetTableSize());
+    table_ = cells_.data();
+    parallel::ParallelFor(0, terminal_count_, [&](size_t from) {
+        const auto tree = BuildShortestPathTree(graph_, terminals[from]);
+        Cell* row = cells_.data() + Index(static_cast<uint32_t>(from), 0);
+        for (size_t to = 0; to < terminal_count_; ++to) {
+            if (tree.IsReachable(terminals[to])) {
+                row[to] = {static_cast<float>(tree.weights[terminals[to]]), tree.prev_edges[terminals[to]]};
+            }
+        }
+    });
+}
+
+template <typename Weight>
+CompactRouter<Weight>::CompactRouter(const Graph& graph, const std::vector<VertexId>& terminals, const Cell* table)
+    : graph_(graph)
+    , terminal_count_(terminals.size())
+    , terminal_indices_(graph.GetVertexCount(), NOT_TERMINAL)
+    , table_(table)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building CompactRouter");
+    }
+    IndexTerminals(terminals);
+}
+
+template <typename Weight>
+void CompactRouter<Weight>::IndexTerminals(const std::vector<VertexId>& terminals) {
+    for (uint32_t index = 0; index < terminal_count_; ++index) {
+        terminal_indices_.at(terminals[index]) = index;
+    }
+    for (VertexId vertex = 0; vertex < graph_.GetVertexCount(); ++vertex) {
+        const auto incoming_arcs = graph_.GetIncomingArcs(vertex);
+        if (terminal_indices_[vertex] == NOT_TERMINAL && std::distance(incoming_arcs.begin(), incoming_arcs.end()) > 1) {
+            throw std::invalid_argument("Non-terminal vertices should have at most one incoming edge");
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename CompactRouter<Weight>::RouteInfo> CompactRouter<Weight>::BuildRoute(VertexId from,
+                                                                                           VertexId to) const {
+    const uint32_t from_index = TerminalIndex(from);
+    if (table_[Index(from_index, TerminalIndex(to))].weight == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+
+    // Точный вес пересчитывается по ребрам, во float хранится только приближение
+    std::vector<EdgeId> edges;
+    Weight weight{};
+    VertexId vertex = to;
+    while (vertex != from) {
+        EdgeId edge_id = NO_EDGE;
+        if (terminal_indices_[vertex] != NOT_TERMINAL) {
+            edge_id = table_[Index(from_index, terminal_indices_[vertex])].prev_edge;
+        } else {
+            edge_id = (*graph_.GetIncomingArcs(vertex).begin()).edge_id;
+        }
+        const auto& edge = graph_.GetEdge(edge_id);
+        edges.push_back(edge_id);
+        weight += edge.weight;
+        vertex = edge.from;
+    }
+    std::reverse(edges.begin(), edges.end());
+    return RouteInfo{weight, std::move(edges)};
+}
+
+}  // namespace graph
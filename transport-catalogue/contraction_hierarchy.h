@@ -0,0 +1,577 @@
+#pragma once
+
+#include "graph.h"
+#include "parallel.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <optional>
+#include <queue>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизатор на иерархиях сжатия (Contraction Hierarchies).
+// Предподсчет по очереди «стягивает» вершины, начиная с наименее важных, и добавляет ребра-сокращения там,
+// где без стянутой вершины кратчайший путь удлинился бы. Запрос - двунаправленный Дейкстра,
+// который идет только вверх по иерархии, поэтому просматривает лишь малую часть графа.
+// Сокращения при ответе раскрываются в исходные ребра графа.
+template <typename Weight>
+class ContractionHierarchyRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    explicit ContractionHierarchyRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Многие-ко-многим через корзины: обратный поиск вверх из каждой цели оставляет в просмотренных вершинах
+    // пары (цель, вес), прямой поиск вверх из каждого начала складывает свой вес с весами из корзин.
+    // Поисков sources.size() + targets.size() вместо sources.size() * targets.size()
+    std::vector<Weight> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                          const std::vector<VertexId>& targets) const override;
+
+    [[nodiscard]] size_t GetShortcutCount() const {
+        return shortcut_count_;
+    }
+
+private:
+    using ChEdgeId = uint32_t;
+    static constexpr ChEdgeId NO_CH_EDGE = std::numeric_limits<ChEdgeId>::max();
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    // Ограничение поиска свидетелей: если путь не найден за это число вершин, добавляется сокращение
+    static constexpr size_t WITNESS_SETTLED_LIMIT = 100;
+
+    // Ребро иерархии: либо исходное ребро графа, либо сокращение из двух ребер иерархии
+    struct ChEdge {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        EdgeId original;
+        ChEdgeId first_child;
+        ChEdgeId second_child;
+    };
+
+    struct Shortcut {
+        VertexId from;
+        VertexId to;
+        Weight weight;
+        ChEdgeId first_child;
+        ChEdgeId second_child;
+    };
+
+    // Состояние графа во время стягивания вершин
+    struct ContractionState {
+        std::vector<std::vector<ChEdgeId>> out_edges;
+        std::vector<std::vector<ChEdgeId>> in_edges;
+        std::vector<bool> contracted;
+        std::vector<uint32_t> contracted_neighbours;
+        // Буферы поиска свидетелей, переиспользуются между поисками
+        std::vector<Weight> witness_weights;
+        std::vector<VertexId> touched;
+        std::vector<bool> is_witness_target;
+    };
+
+    using QueueItem = std::pair<Weight, VertexId>;
+    using Queue = std::priority_queue<QueueItem, std::vector<QueueItem>, std::greater<>>;
+
+    void Preprocess();
+
+    // Оставляет для каждой пары соседей самое легкое ребро среди еще не стянутых вершин
+    std::vector<ChEdgeId> LightestEdges(const std::vector<ChEdgeId>& edge_ids, const ContractionState& state,
+                                        VertexId vertex, bool outgoing) const;
+
+    std::vector<Shortcut> FindShortcuts(VertexId vertex, ContractionState& state) const;
+
+    // Можно ли попасть в target в обход excluded. Если нет, свидетеля не найти и искать его незачем:
+    // так, в вершину посадки ведет только ребро ожидания от своей остановки.
+    bool HasOtherInEdges(VertexId target, VertexId excluded, const ContractionState& state) const {
+        return std::any_of(state.in_edges[target].begin(), state.in_edges[target].end(), [&](ChEdgeId edge_id) {
+            return edges_[edge_id].from != excluded;
+        });
+    }
+
+    // Дейкстра из source в обход excluded; останавливается, когда просмотрены все target_count целей
+    void WitnessSearch(VertexId source, VertexId excluded, Weight limit, size_t target_count,
+                       ContractionState& state) const;
+
+    // Удвоенная разность числа добавляемых и удаляемых ребер плюс число уже стянутых соседей.
+    // Найденные сокращения сохраняются в shortcuts, чтобы не искать их повторно при стягивании.
+    int Priority(VertexId vertex, ContractionState& state, std::vector<Shortcut>& shortcuts) const;
+
+    void Contract(VertexId vertex, const std::vector<Shortcut>& shortcuts, ContractionState& state);
+
+    void BuildSearchGraph();
+
+    void UnpackEdge(ChEdgeId edge_id, std::vector<EdgeId>& edges) const;
+
+    // Полный поиск вверх по иерархии без остановки: прямой по ребрам вверх, обратный - по ребрам сверху.
+    // Возвращает просмотренные вершины с весами
+    std::vector<std::pair<VertexId, Weight>> UpwardSearch(VertexId start, bool forward) const;
+
+    // Запись корзины вершины: номер цели и вес пути от вершины до нее
+    struct BucketEntry {
+        uint32_t target;
+        Weight weight;
+    };
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = InfiniteWeight<Weight>();
+    const Graph& graph_;
+    std::vector<ChEdge> edges_;
+    std::vector<uint32_t> ranks_;
+    size_t shortcut_count_ = 0;
+
+    // Ребра, ведущие вверх по иерархии, для прямого поиска
+    std::vector<size_t> up_offsets_;
+    std::vector<ChEdgeId> up_edges_;
+    // Ребра, входящие в вершину сверху, для обратного поиска
+    std::vector<size_t> down_offsets_;
+    std::vector<ChEdgeId> down_edges_;
+};
+
+template <typename Weight>
+ContractionHierarchyRouter<Weight>::ContractionHierarchyRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building ContractionHierarchyRouter");
+    }
+    Preprocess();
+    BuildSearchGraph();
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::Preprocess() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    ContractionState state{std::vector<std::vector<ChEdgeId>>(vertex_count),
+                           std::vector<std::vector<ChEdgeId>>(vertex_count),
+                           std::vector<bool>(vertex_count, false),
+                           std::vector<uint32_t>(vertex_count, 0),
+                           std::vector<Weight>(vertex_count, INFINITE_WEIGHT),
+                           {},
+                           std::vector<bool>(vertex_count, false)};
+
+    // Параллельные ребра не нужны поиску: оставляем самое легкое, при равенстве - с меньшим id
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        std::vector<std::pair<VertexId, EdgeId>> best;
+        for (const auto& arc : graph_.GetIncidentArcs(vertex)) {
+            if (arc.weight < ZERO_WEIGHT) {
+                throw std::domain_error("Edges' weights should be non-negative");
+            }
+            if (arc.vertex != vertex) {
+                best.emplace_back(arc.vertex, arc.edge_id);
+            }
+        }
+        std::sort(best.begin(), best.end(), [this](const auto& lhs, const auto& rhs) {
+            return std::tuple(lhs.first, graph_.GetEdge(lhs.second).weight, lhs.second)
+                   < std::tuple(rhs.first, graph_.GetEdge(rhs.second).weight, rhs.second);
+        });
+        for (size_t i = 0; i < best.size(); ++i) {
+            if (i > 0 && best[i].first == best[i - 1].first) {
+                continue;
+            }
+            const auto& edge = graph_.GetEdge(best[i].second);
+            const auto id = static_cast<ChEdgeId>(edges_.size());
+            edges_.push_back({edge.from, edge.to, edge.weight, best[i].second, NO_CH_EDGE, NO_CH_EDGE});
+            state.out_edges[edge.from].push_back(id);
+            state.in_edges[edge.to].push_back(id);
+        }
+    }
+
+    // Порядок стягивания: сначала вершины, стягивание которых добавит меньше всего ребер.
+    // Приоритеты пересчитываются лениво, когда вершина оказывается в начале очереди.
+    using PriorityItem = std::pair<int, VertexId>;
+    std::priority_queue<PriorityItem, std::vector<PriorityItem>, std::greater<>> order;
+    std::vector<Shortcut> shortcuts;
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        order.push({Priority(vertex, state, shortcuts), vertex});
+    }
+
+    ranks_.assign(vertex_count, 0);
+    uint32_t rank = 0;
+    while (!order.empty()) {
+        const VertexId vertex = order.top().second;
+        order.pop();
+        const int priority = Priority(vertex, state, shortcuts);
+        if (!order.empty() && priority > order.top().first) {
+            order.push({priority, vertex});
+            continue;
+        }
+        Contract(vertex, shortcuts, state);
+        ranks_[vertex] = rank++;
+    }
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::Contract(VertexId vertex, const std::vector<Shortcut>& shortcuts,
+                                                  ContractionState& state) {
+    for (const Shortcut& shortcut : shortcuts) {
+        const auto id = static_cast<ChEdgeId>(edges_.size());
+        edges_.push_back({shortcut.from, shortcut.to, shortcut.weight, NO_EDGE,
+                          shortcut.first_child, shortcut.second_child});
+        state.out_edges[shortcut.from].push_back(id);
+        state.in_edges[shortcut.to].push_back(id);
+        ++shortcut_count_;
+    }
+    state.contracted[vertex] = true;
+
+    // Ребра стянутой вершины убираются из списков соседей, чтобы дальнейшие поиски их не просматривали
+    const auto remove_edges_to = [vertex](std::vector<ChEdgeId>& edge_ids, const auto& other_end) {
+        edge_ids.erase(std::remove_if(edge_ids.begin(), edge_ids.end(), [&](ChEdgeId edge_id) {
+            return other_end(edge_id) == vertex;
+        }), edge_ids.end());
+    };
+    for (const ChEdgeId edge_id : state.out_edges[vertex]) {
+        const VertexId neighbour = edges_[edge_id].to;
+        ++state.contracted_neighbours[neighbour];
+        remove_edges_to(state.in_edges[neighbour], [this](ChEdgeId id) { return edges_[id].from; });
+    }
+    for (const ChEdgeId edge_id : state.in_edges[vertex]) {
+        const VertexId neighbour = edges_[edge_id].from;
+        ++state.contracted_neighbours[neighbour];
+        remove_edges_to(state.out_edges[neighbour], [this](ChEdgeId id) { return edges_[id].to; });
+    }
+    std::vector<ChEdgeId>().swap(state.out_edges[vertex]);
+    std::vector<ChEdgeId>().swap(state.in_edges[vertex]);
+}
+
+template <typename Weight>
+std::vector<typename ContractionHierarchyRouter<Weight>::ChEdgeId>
+ContractionHierarchyRouter<Weight>::LightestEdges(const std::vector<ChEdgeId>& edge_ids,
+                                                  const ContractionState& state,
+                                                  VertexId vertex, bool outgoing) const {
+    const auto neighbour = [&](ChEdgeId edge_id) {
+        return outgoing ? edges_[edge_id].to : edges_[edge_id].from;
+    };
+    std::vector<ChEdgeId> result;
+    for (const ChEdgeId edge_id : edge_ids) {
+        const VertexId other = neighbour(edge_id);
+        if (other != vertex && !state.contracted[other]) {
+            result.push_back(edge_id);
+        }
+    }
+    std::sort(result.begin(), result.end(), [&](ChEdgeId lhs, ChEdgeId rhs) {
+        return std::tuple(neighbour(lhs), edges_[lhs].weight, lhs) < std::tuple(neighbour(rhs), edges_[rhs].weight, rhs);
+    });
+    result.erase(std::unique(result.begin(), result.end(), [&](ChEdgeId lhs, ChEdgeId rhs) {
+        return neighbour(lhs) == neighbour(rhs);
+    }), result.end());
+    return result;
+}
+
+template <typename Weight>
+std::vector<typename ContractionHierarchyRouter<Weight>::Shortcut>
+ContractionHierarchyRouter<Weight>::FindShortcuts(VertexId vertex, ContractionState& state) const {
+    std::vector<Shortcut> shortcuts;
+    const std::vector<ChEdgeId> in_edges = LightestEdges(state.in_edges[vertex], state, vertex, false);
+    const std::vector<ChEdgeId> out_edges = LightestEdges(state.out_edges[vertex], state, vertex, true);
+    if (in_edges.empty() || out_edges.empty()) {
+        return shortcuts;
+    }
+
+    for (const ChEdgeId in_edge_id : in_edges) {
+        const ChEdge& in_edge = edges_[in_edge_id];
+        Weight max_out_weight = ZERO_WEIGHT;
+        size_t target_count = 0;
+        for (const ChEdgeId out_edge_id : out_edges) {
+            const VertexId target = edges_[out_edge_id].to;
+            if (target != in_edge.from && HasOtherInEdges(target, vertex, state)) {
+                max_out_weight = std::max(max_out_weight, edges_[out_edge_id].weight);
+                state.is_witness_target[target] = true;
+                ++target_count;
+            }
+        }
+
+        if (target_count > 0) {
+            WitnessSearch(in_edge.from, vertex, in_edge.weight + max_out_weight, target_count, state);
+        }
+        for (const ChEdgeId out_edge_id : out_edges) {
+            const ChEdge& out_edge = edges_[out_edge_id];
+            if (out_edge.to == in_edge.from) {
+                continue;
+            }
+            const Weight weight = in_edge.weight + out_edge.weight;
+            if (weight < state.witness_weights[out_edge.to]) {
+                shortcuts.push_back({in_edge.from, out_edge.to, weight, in_edge_id, out_edge_id});
+            }
+        }
+        for (const VertexId touched : state.touched) {
+            state.witness_weights[touched] = INFINITE_WEIGHT;
+        }
+        state.touched.clear();
+        for (const ChEdgeId out_edge_id : out_edges) {
+            state.is_witness_target[edges_[out_edge_id].to] = false;
+        }
+    }
+    return shortcuts;
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::WitnessSearch(VertexId source, VertexId excluded, Weight limit,
+                                                       size_t target_count, ContractionState& state) const {
+    Queue queue;
+    state.witness_weights[source] = ZERO_WEIGHT;
+    state.touched.push_back(source);
+    queue.push({ZERO_WEIGHT, source});
+    size_t settled = 0;
+    while (!queue.empty() && settled < WITNESS_SETTLED_LIMIT && target_count > 0) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > state.witness_weights[vertex]) {
+            continue;
+        }
+        if (weight > limit) {
+            break;
+        }
+        ++settled;
+        if (state.is_witness_target[vertex]) {
+            --target_count;
+        }
+        for (const ChEdgeId edge_id : state.out_edges[vertex]) {
+            const ChEdge& edge = edges_[edge_id];
+            if (edge.to == excluded) {
+                continue;
+            }
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < state.witness_weights[edge.to]) {
+                if (state.witness_weights[edge.to] == INFINITE_WEIGHT) {
+                    state.touched.push_back(edge.to);
+                }
+                state.witness_weights[edge.to] = candidate_weight;
+                queue.push({candidate_weight, edge.to});
+            }
+        }
+    }
+}
+
+template <typename Weight>
+int ContractionHierarchyRouter<Weight>::Priority(VertexId vertex, ContractionState& state,
+                                                 std::vector<Shortcut>& shortcuts) const {
+    const auto removed_edges = state.in_edges[vertex].size() + state.out_edges[vertex].size();
+    shortcuts = FindShortcuts(vertex, state);
+    return 2 * (static_cast<int>(shortcuts.size()) - static_cast<int>(removed_edges))
+           + static_cast<int>(state.contracted_neighbours[vertex]);
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::BuildSearchGraph() {
+    const size_t vertex_count = graph_.GetVertexCount();
+    up_offsets_.assign(vertex_count + 1, 0);
+    down_offsets_.assign(vertex_count + 1, 0);
+    for (const ChEdge& edge : edges_) {
+        if (ranks_[edge.from] < ranks_[edge.to]) {
+            ++up_offsets_[edge.from + 1];
+        } else {
+            ++down_offsets_[edge.to + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        up_offsets_[vertex + 1] += up_offsets_[vertex];
+        down_offsets_[vertex + 1] += down_offsets_[vertex];
+    }
+    up_edges_.resize(up_offsets_.back());
+    down_edges_.resize(down_offsets_.back());
+    std::vector<size_t> up_positions(up_offsets_.begin(), std::prev(up_offsets_.end()));
+    std::vector<size_t> down_positions(down_offsets_.begin(), std::prev(down_offsets_.end()));
+    for (ChEdgeId edge_id = 0; edge_id < edges_.size(); ++edge_id) {
+        const ChEdge& edge = edges_[edge_id];
+        if (ranks_[edge.from] < ranks_[edge.to]) {
+            up_edges_[up_positions[edge.from]++] = edge_id;
+        } else {
+            down_edges_[down_positions[edge.to]++] = edge_id;
+        }
+    }
+}
+
+template <typename Weight>
+std::optional<typename ContractionHierarchyRouter<Weight>::RouteInfo>
+ContractionHierarchyRouter<Weight>::BuildRoute(VertexId from, VertexId to) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    if (from >= vertex_count || to >= vertex_count) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (from == to) {
+        return RouteInfo{ZERO_WEIGHT, {}};
+    }
+
+    // Индекс 0 - прямой поиск вверх от from, индекс 1 - обратный поиск вверх от to
+    std::vector<Weight> weights[2] = {std::vector<Weight>(vertex_count, INFINITE_WEIGHT),
+                                      std::vector<Weight>(vertex_count, INFINITE_WEIGHT)};
+    std::vector<ChEdgeId> prev_edges[2] = {std::vector<ChEdgeId>(vertex_count, NO_CH_EDGE),
+                                           std::vector<ChEdgeId>(vertex_count, NO_CH_EDGE)};
+    Queue queues[2];
+    weights[0][from] = ZERO_WEIGHT;
+    weights[1][to] = ZERO_WEIGHT;
+    queues[0].push({ZERO_WEIGHT, from});
+    queues[1].push({ZERO_WEIGHT, to});
+
+    Weight best_weight = INFINITE_WEIGHT;
+    std::optional<VertexId> meeting_vertex;
+
+    // Каждый поиск заканчивается, когда его минимальный ключ не меньше лучшего найденного пути
+    while (true) {
+        for (auto& queue : queues) {
+            if (!queue.empty() && !(queue.top().first < best_weight)) {
+                queue = Queue{};
+            }
+        }
+        if (queues[0].empty() && queues[1].empty()) {
+            break;
+        }
+        const size_t side = queues[1].empty()
+                            || (!queues[0].empty() && queues[0].top().first <= queues[1].top().first) ? 0 : 1;
+        const auto [weight, vertex] = queues[side].top();
+        queues[side].pop();
+        if (weight > weights[side][vertex]) {
+            continue;
+        }
+        if (weights[1 - side][vertex] != INFINITE_WEIGHT && weight + weights[1 - side][vertex] < best_weight) {
+            best_weight = weight + weights[1 - side][vertex];
+            meeting_vertex = vertex;
+        }
+
+        const auto& offsets = side == 0 ? up_offsets_ : down_offsets_;
+        const auto& search_edges = side == 0 ? up_edges_ : down_edges_;
+        for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+            const ChEdgeId edge_id = search_edges[i];
+            const ChEdge& edge = edges_[edge_id];
+            const VertexId next = side == 0 ? edge.to : edge.from;
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < weights[side][next]) {
+                weights[side][next] = candidate_weight;
+                prev_edges[side][next] = edge_id;
+                queues[side].push({candidate_weight, next});
+            }
+        }
+    }
+
+    if (!meeting_vertex) {
+        return std::nullopt;
+    }
+
+    std::vector<ChEdgeId> ch_edges;
+    for (ChEdgeId edge_id = prev_edges[0][*meeting_vertex]; edge_id != NO_CH_EDGE;
+         edge_id = prev_edges[0][edges_[edge_id].from]) {
+        ch_edges.push_back(edge_id);
+    }
+    std::reverse(ch_edges.begin(), ch_edges.end());
+    for (ChEdgeId edge_id = prev_edges[1][*meeting_vertex]; edge_id != NO_CH_EDGE;
+         edge_id = prev_edges[1][edges_[edge_id].to]) {
+        ch_edges.push_back(edge_id);
+    }
+
+    std::vector<EdgeId> edges;
+    for (const ChEdgeId edge_id : ch_edges) {
+        UnpackEdge(edge_id, edges);
+    }
+    return RouteInfo{best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::vector<std::pair<VertexId, Weight>> ContractionHierarchyRouter<Weight>::UpwardSearch(VertexId start,
+                                                                                         bool forward) const {
+    std::vector<Weight> weights(graph_.GetVertexCount(), INFINITE_WEIGHT);
+    std::vector<std::pair<VertexId, Weight>> settled;
+    Queue queue;
+    weights[start] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, start});
+    const auto& offsets = forward ? up_offsets_ : down_offsets_;
+    const auto& search_edges = forward ? up_edges_ : down_edges_;
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > weights[vertex]) {
+            continue;
+        }
+        settled.emplace_back(vertex, weight);
+        for (size_t i = offsets[vertex]; i < offsets[vertex + 1]; ++i) {
+            const ChEdge& edge = edges_[search_edges[i]];
+            const VertexId next = forward ? edge.to : edge.from;
+            const Weight candidate_weight = weight + edge.weight;
+            if (candidate_weight < weights[next]) {
+                weights[next] = candidate_weight;
+                queue.push({candidate_weight, next});
+            }
+        }
+    }
+    return settled;
+}
+
+template <typename Weight>
+std::vector<Weight> ContractionHierarchyRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                                          const std::vector<VertexId>& targets) const {
+    const size_t vertex_count = graph_.GetVertexCount();
+    for (const VertexId vertex : sources) {
+        if (vertex >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+    for (const VertexId vertex : targets) {
+        if (vertex >= vertex_count) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+
+    std::vector<std::vector<std::pair<VertexId, Weight>>> backward_spaces(targets.size());
+    parallel::ParallelFor(0, targets.size(), [&](size_t column) {
+        backward_spaces[column] = UpwardSearch(targets[column], false);
+    });
+
+    // Корзины всех вершин одним массивом со смещениями, внутри корзины цели идут по возрастанию
+    std::vector<size_t> bucket_offsets(vertex_count + 1, 0);
+    for (const auto& space : backward_spaces) {
+        for (const auto& [vertex, weight] : space) {
+            ++bucket_offsets[vertex + 1];
+        }
+    }
+    for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
+        bucket_offsets[vertex + 1] += bucket_offsets[vertex];
+    }
+    std::vector<BucketEntry> buckets(bucket_offsets.back());
+    std::vector<size_t> positions(bucket_offsets.begin(), std::prev(bucket_offsets.end()));
+    for (uint32_t column = 0; column < targets.size(); ++column) {
+        for (const auto& [vertex, weight] : backward_spaces[column]) {
+            buckets[positions[vertex]++] = {column, weight};
+        }
+        std::vector<std::pair<VertexId, Weight>>().swap(backward_spaces[column]);
+    }
+
+    std::vector<Weight> weights(sources.size() * targets.size(), INFINITE_WEIGHT);
+    parallel::ParallelFor(0, sources.size(), [&](size_t row) {
+        Weight* row_weights = weights.data() + row * targets.size();
+        for (const auto& [vertex, weight] : UpwardSearch(sources[row], true)) {
+            for (size_t i = bucket_offsets[vertex]; i < bucket_offsets[vertex + 1]; ++i) {
+                const BucketEntry& entry = buckets[i];
+                row_weights[entry.target] = std::min(row_weights[entry.target], weight + entry.weight);
+            }
+        }
+    });
+    return weights;
+}
+
+template <typename Weight>
+void ContractionHierarchyRouter<Weight>::UnpackEdge(ChEdgeId edge_id, std::vector<EdgeId>& edges) const {
+    std::vector<ChEdgeId> stack{edge_id};
+    while (!stack.empty()) {
+        const ChEdge& edge = edges_[stack.back()];
+        stack.pop_back();
+        if (edge.original != NO_EDGE) {
+            edges.push_back(edge.original);
+        } else {
+            stack.push_back(edge.second_child);
+            stack.push_back(edge.first_child);
+        }
+    }
+}
+
+}  // namespace graph
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "graph.h"
+#include "parallel.h"
+#include "radix_heap.h"
+#include "router.h"
+#include "shortest_path_tree.h"
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Поиск маршрута по запросу двунаправленным алгоритмом Дейкстры.
+// Граф должен быть заморожен: поиски идут по его сжатым спискам исходящих и входящих ребер.
+// Каждый запрос останавливается, как только встречные поиски гарантированно нашли кратчайший путь.
+// Для беззнаковых целых весов очереди - RadixHeap.
+template <typename Weight>
+class DijkstraRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    explicit DijkstraRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Одно дерево кратчайших путей на начальную вершину вместо поиска на каждую пару
+    std::vector<Weight> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                          const std::vector<VertexId>& targets) const override;
+
+    // Для нескольких вершин - одно дерево кратчайших путей из from вместо поиска на каждую
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override {
+        if (targets.size() < 2) {
+            return BaseRouter<Weight>::BuildRoutes(from, targets);
+        }
+        return BuildTreeRoutes(graph_, from, targets);
+    }
+
+private:
+    using Queue = MinQueue<Weight, VertexId>;
+
+    struct SearchData {
+        std::vector<Weight> weights;
+        std::vector<std::optional<EdgeId>> prev_edges;
+        Queue queue;
+    };
+
+    SearchData MakeSearchData(VertexId start) const {
+        SearchData data{std::vector<Weight>(graph_.GetVertexCount(), INFINITE_WEIGHT),
+                        std::vector<std::optional<EdgeId>>(graph_.GetVertexCount()),
+                        Queue{}};
+        data.weights[start] = ZERO_WEIGHT;
+        data.queue.push({ZERO_WEIGHT, start});
+        return data;
+    }
+
+    // Извлекает вершину из очереди одного из поисков и релаксирует ее ребра.
+    // forward определяет направление: по исходящим ребрам или по входящим.
+    void SearchStep(bool forward, SearchData& search, const SearchData& opposite,
+                    Weight& best_weight, std::optional<VertexId>& meeting_vertex) const {
+        const auto [weight, vertex] = search.queue.top();
+        search.queue.pop();
+        if (weight > search.weights[vertex]) {
+            return;
+        }
+        const auto arcs = forward ? graph_.GetIncidentArcs(vertex) : graph_.GetIncomingArcs(vertex);
+        for (const auto& arc : arcs) {
+            const VertexId next = arc.vertex;
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < search.weights[next]) {
+                search.weights[next] = candidate_weight;
+                search.prev_edges[next] = arc.edge_id;
+                search.queue.push({candidate_weight, next});
+            }
+            if (opposite.weights[next] != INFINITE_WEIGHT
+                && search.weights[next] + opposite.weights[next] < best_weight) {
+                best_weight = search.weights[next] + opposite.weights[next];
+                meeting_vertex = next;
+            }
+        }
+    }
+
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = InfiniteWeight<Weight>();
+    const Graph& graph_;
+};
+
+template <typename Weight>
+DijkstraRouter<Weight>::DijkstraRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building DijkstraRouter");
+    }
+    if (graph.HasNegativeWeights()) {
+        throw std::domain_error("Edges' weights should be non-negative");
+    }
+}
+
+template <typename Weight>
+std::optional<typename DijkstraRouter<Weight>::RouteInfo> DijkstraRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (from == to) {
+        return RouteInfo{ZERO_WEIGHT, {}};
+    }
+
+    SearchData forward = MakeSearchData(from);
+    SearchData backward = MakeSearchData(to);
+    Weight best_weight = INFINITE_WEIGHT;
+    std::optional<VertexId> meeting_vertex;
+
+    // Если одна из очередей опустела, все достижимые с ее стороны вершины уже просмотрены
+    while (!forward.queue.empty() && !backward.queue.empty()) {
+        const Weight forward_top = forward.queue.top().first;
+        const Weight backward_top = backward.queue.top().first;
+        if (best_weight != INFINITE_WEIGHT && !(forward_top + backward_top < best_weight)) {
+            break;
+        }
+        if (forward_top <= backward_top) {
+            SearchStep(true, forward, backward, best_weight, meeting_vertex);
+        } else {
+            SearchStep(false, backward, forward, best_weight, meeting_vertex);
+        }
+    }
+
+    if (!meeting_vertex) {
+        return std::nullopt;
+    }
+
+    std::vector<EdgeId> edges;
+    for (std::optional<EdgeId> edge_id = forward.prev_edges[*meeting_vertex];
+         edge_id;
+         edge_id = forward.prev_edges[graph_.GetEdge(*edge_id).from])
+    {
+        edges.push_back(*edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    for (std::optional<EdgeId> edge_id = backward.prev_edges[*meeting_vertex];
+         edge_id;
+         edge_id = backward.prev_edges[graph_.GetEdge(*edge_id).to])
+    {
+        edges.push_back(*edge_id);
+    }
+
+    return RouteInfo{best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::vector<Weight> DijkstraRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                              const std::vector<VertexId>& targets) const {
+    for (const VertexId to : targets) {
+        if (to >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+    std::vector<Weight> weights(sources.size() * targets.size(), INFINITE_WEIGHT);
+    parallel::ParallelFor(0, sources.size(), [&](size_t row) {
+        if (sources[row] >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        const auto tree = BuildShortestPathTree(graph_, sources[row]);
+        for (size_t column = 0; column < targets.size(); ++column) {
+            weights[row * targets.size() + column] = tree.weights[targets[column]];
+        }
+    });
+    return weights;
+}
+
+}  // namespace graph
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include "geo.h"
@@ -47,3 +49,31 @@ struct RouteInfo {
     double length;
     double curvature;
 };
+
+// Этап маршрута между остановками: ожидание автобуса на остановке или поездка на автобусе.
+// Поля упорядочены так, чтобы этап занимал 32 байта
+struct RouteItem {
+    enum class Type : uint8_t {
+        Wait,
+        Bus
+    };
+
+    // Название остановки для ожидания или автобуса для поездки, ссылается на строку справочника
+    std::string_view name;
+    double time;
+    // Количество пролетов поездки, для ожидания 0
+    uint32_t span_count;
+    Type type;
+};
+
+// Маршрут между остановками в том виде, в котором он выводится в ответ на запрос Route
+struct Itinerary {
+    double total_time;
+    std::vector<RouteItem> items;
+};
+
+// Остановка, до которой можно доехать за отведенное время (ответ на запрос Isochrone)
+struct ReachableStop {
+    std::string_view name;
+    double time;
+};
@@ -0,0 +1,123 @@
+#pragma once
+
+#include "graph.h"
+#include "router.h"
+
+#include <cmath>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Копия замороженного графа с целыми весами: weight * scale с округлением до ближайшего.
+// Линии остаются линиями, а округляются их смещения, деленные на делитель, поэтому вес ребра линии
+// может отличаться от округленного веса на единицу. Номера вершин и ребер совпадают с исходным графом
+template <typename FixedWeight, typename Weight>
+DirectedWeightedGraph<FixedWeight> MakeFixedPointGraph(const DirectedWeightedGraph<Weight>& graph, double scale) {
+    static_assert(std::is_integral_v<FixedWeight>, "Fixed-point weights should be integers");
+    // Наибольшее значение зарезервировано под бесконечный вес
+    static constexpr double MAX_WEIGHT = static_cast<double>(std::numeric_limits<FixedWeight>::max() - 1);
+
+    const auto to_fixed = [](double value) {
+        const double weight = std::round(value);
+        if (!(weight >= 0.0 && weight <= MAX_WEIGHT)) {
+            throw std::out_of_range("Edge weight does not fit into fixed-point weight");
+        }
+        return static_cast<FixedWeight>(weight);
+    };
+    const auto to_fixed_line = [&graph, &to_fixed, scale](uint32_t line_index) {
+        const auto& line = graph.GetLine(line_index);
+        Line<FixedWeight> fixed_line{line.departures, line.arrivals, {}, FixedWeight{1}};
+        fixed_line.offsets.reserve(line.offsets.size());
+        for (const Weight offset : line.offsets) {
+            fixed_line.offsets.push_back(to_fixed(static_cast<double>(offset / line.divisor) * scale));
+            // Смещения без знака должны расти, иначе разность станет огромным весом
+            if (fixed_line.offsets.size() > 1 && fixed_line.offsets.back() < fixed_line.offsets.rbegin()[1]) {
+                throw std::out_of_range("Edge weight does not fit into fixed-point weight");
+            }
+        }
+        return fixed_line;
+    };
+
+    DirectedWeightedGraph<FixedWeight> fixed_graph(graph.GetVertexCount());
+    fixed_graph.ReserveEdges(static_cast<size_t>(
+            std::distance(graph.GetStoredEdges().begin(), graph.GetStoredEdges().end())));
+    // Линии вставляются между хранимыми ребрами там же, где в исходном графе, чтобы номера ребер совпали
+    uint32_t line_index = 0;
+    for (const auto& edge : graph.GetStoredEdges()) {
+        while (line_index < graph.GetLineCount()
+               && graph.GetLineFirstEdge(line_index) == fixed_graph.GetEdgeCount()) {
+            fixed_graph.AddLine(to_fixed_line(line_index++));
+        }
+        fixed_graph.AddEdge({edge.from, edge.to, to_fixed(static_cast<double>(edge.weight) * scale)});
+    }
+    for (; line_index < graph.GetLineCount(); ++line_index) {
+        fixed_graph.AddLine(to_fixed_line(line_index));
+    }
+    fixed_graph.Freeze();
+    return fixed_graph;
+}
+
+// Маршрутизатор, который ищет маршруты по копии графа с целыми весами (меньше памяти в таблицах,
+// монотонные очереди), а вес найденного маршрута считает по ребрам исходного графа.
+// Маршрут может отличаться от найденного по исходным весам только при разнице меньше ошибки округления.
+template <typename Weight, typename FixedWeight>
+class FixedPointRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using FixedGraph = DirectedWeightedGraph<FixedWeight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    // make_router(fixed_graph) строит маршрутизатор по графу с целыми весами, который хранится здесь же
+    template <typename MakeRouter>
+    FixedPointRouter(const Graph& graph, double scale, MakeRouter make_router)
+        : graph_(graph)
+        , fixed_graph_(MakeFixedPointGraph<FixedWeight>(graph, scale))
+        , router_(make_router(fixed_graph_))
+    {
+    }
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override {
+        auto route = router_->BuildRoute(from, to);
+        if (!route) {
+            return std::nullopt;
+        }
+        return RestoreWeight(std::move(route->edges));
+    }
+
+    // Маршруты ищет маршрутизатор по графу с целыми весами, например одним деревом для нескольких вершин
+    std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                      const std::vector<VertexId>& targets) const override {
+        auto fixed_routes = router_->BuildRoutes(from, targets);
+        std::vector<std::optional<RouteInfo>> routes;
+        routes.reserve(fixed_routes.size());
+        for (auto& route : fixed_routes) {
+            routes.push_back(route ? std::optional(RestoreWeight(std::move(route->edges))) : std::nullopt);
+        }
+        return routes;
+    }
+
+private:
+    // Вес маршрута по ребрам исходного графа
+    RouteInfo RestoreWeight(std::vector<EdgeId> edges) const {
+        Weight weight{};
+        for (const EdgeId edge_id : edges) {
+            weight += graph_.GetEdge(edge_id).weight;
+        }
+        return RouteInfo{weight, std::move(edges)};
+    }
+
+    const Graph& graph_;
+    FixedGraph fixed_graph_;
+    std::unique_ptr<BaseRouter<FixedWeight>> router_;
+};
+
+}  // namespace graph
@@ -2,75 +2,617 @@
 
 #include "ranges.h"
 
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
 #include <cstdlib>
+#include <iterator>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
 #include <vector>
 
 namespace graph {
 
-    using VertexId = size_t;
-    using EdgeId = size_t;
+    using VertexId = uint32_t;
+    using EdgeId = uint32_t;
 
+    // Значение веса для недостижимых вершин
+    template <typename Weight>
+    constexpr Weight InfiniteWeight() {
+        if constexpr (std::numeric_limits<Weight>::has_infinity) {
+            return std::numeric_limits<Weight>::infinity();
+        } else {
+            return std::numeric_limits<Weight>::max();
+        }
+    }
+
+    // В ребре хранится только то, что нужно поиску пути. Описание ребра
+    // (название, количество пролетов и т.п.) хранит владелец графа отдельно по EdgeId.
     template <typename Weight>
     struct Edge {
-        std::string name;
-        size_t quality;
         VertexId from;
         VertexId to;
         Weight weight;
     };
 
+    // Элемент сжатого списка смежности: ребро и вершина на другом его конце
+    template <typename Weight>
+    struct Arc {
+        EdgeId edge_id;
+        VertexId vertex;
+        Weight weight;
+    };
+
+    // Линия - неявные ребра departures[i] -> arrivals[j] для всех i < j с весом (offsets[j] - offsets[i]) / divisor.
+    // Так задается автобус: вершины посадки и прибытия его остановок и расстояния от начала маршрута.
+    // Ребра линии не хранятся, а порождаются при обходе дуг, поэтому память линейна по длине маршрута
+    template <typename Weight>
+    struct Line {
+        std::vector<VertexId> departures;
+        std::vector<VertexId> arrivals;
+        std::vector<Weight> offsets;
+        Weight divisor;
+    };
+
+    // Ребро линии: номер линии в порядке добавления и позиции начала и конца
+    struct LineEdge {
+        uint32_t line;
+        uint32_t from_position;
+        uint32_t to_position;
+    };
+
+    // Пока граф строится, ребра хранятся в отдельном списке для каждой вершины.
+    // После Freeze() списки упаковываются в непрерывные массивы (compressed sparse row),
+    // а добавлять ребра больше нельзя.
     template <typename Weight>
     class DirectedWeightedGraph {
     private:
         using IncidenceList = std::vector<EdgeId>;
-        using IncidentEdgesRange = ranges::Range<typename IncidenceList::const_iterator>;
+        using IncidentEdgesRange = ranges::Range<const EdgeId*>;
+        using StoredEdgesRange = ranges::Range<typename std::vector<Edge<Weight>>::const_iterator>;
+
+        // Позиция вершины в линии: с нее есть исходящие (или входящие) ребра линии
+        struct LinePosition {
+            uint32_t line;
+            uint32_t position;
+        };
 
     public:
+        // Итератор по дугам вершины: сначала дуги хранимых ребер, затем ребра линий,
+        // которые вычисляются при разыменовании
+        class ArcIterator {
+        public:
+            using iterator_category = std::forward_iterator_tag;
+            using value_type = Arc<Weight>;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Arc<Weight>*;
+            using reference = Arc<Weight>;
+
+            ArcIterator() = default;
+
+            Arc<Weight> operator*() const;
+            ArcIterator& operator++();
+            ArcIterator operator++(int);
+            bool operator==(const ArcIterator& other) const;
+            bool operator!=(const ArcIterator& other) const;
+
+        private:
+            friend class DirectedWeightedGraph;
+
+            ArcIterator(const DirectedWeightedGraph* graph, bool is_outgoing, const Arc<Weight>* arc,
+                        const Arc<Weight>* arcs_end, const LinePosition* position, const LinePosition* positions_end);
+
+            // Первая позиция на другом конце ребер линии для текущей позиции
+            void StartPosition();
+
+            const DirectedWeightedGraph* graph_ = nullptr;
+            bool is_outgoing_ = true;
+            const Arc<Weight>* arc_ = nullptr;
+            const Arc<Weight>* arcs_end_ = nullptr;
+            const LinePosition* position_ = nullptr;
+            const LinePosition* positions_end_ = nullptr;
+            uint32_t other_position_ = 0;
+        };
+
+        using ArcsRange = ranges::Range<ArcIterator>;
+
         DirectedWeightedGraph() = default;
         explicit DirectedWeightedGraph(size_t vertex_count);
         EdgeId AddEdge(const Edge<Weight>& edge);
+        // Добавляет ребра линии одним блоком номеров подряд: ребро i -> j получает номер
+        // first + (номер строки i в треугольной таблице) + (j - i - 1). Возвращает first
+        EdgeId AddLine(Line<Weight> line);
+        // Резервирует место под ребра, если их количество известно заранее
+        void ReserveEdges(size_t edge_count);
+
+        // Упаковывает списки смежности, после чего доступны GetIncidentArcs и GetIncomingArcs
+        void Freeze();
+        // Возвращает списки смежности, чтобы добавить ребра; номера ребер сохраняются.
+        // После добавления граф нужно снова заморозить
+        void Unfreeze();
+        bool IsFrozen() const;
 
         size_t GetVertexCount() const;
+        // Количество номеров ребер, вместе с ребрами линий
         size_t GetEdgeCount() const;
-        const Edge<Weight>& GetEdge(EdgeId edge_id) const;
+        // Ребро линии вычисляется, поэтому возвращается по значению
+        Edge<Weight> GetEdge(EdgeId edge_id) const;
+        // Линия и позиции ребра или nullopt для хранимого ребра
+        std::optional<LineEdge> GetLineEdge(EdgeId edge_id) const;
+        // Только хранимые ребра вершины, без ребер линий
         IncidentEdgesRange GetIncidentEdges(VertexId vertex) const;
+        // Хранимые ребра всего графа в порядке номеров, без ребер линий
+        StoredEdgesRange GetStoredEdges() const;
+
+        size_t GetLineCount() const;
+        const Line<Weight>& GetLine(uint32_t line) const;
+        // Номер ребра между первыми двумя позициями линии, с него начинается блок ее ребер
+        EdgeId GetLineFirstEdge(uint32_t line) const;
+
+        // Есть ли ребро с отрицательным весом. Веса ребер линии - разности ее смещений,
+        // поэтому достаточно проверить ребра между соседними позициями, а не все ребра линии
+        bool HasNegativeWeights() const;
+
+        // Исходящие ребра вершины, vertex - конец ребра
+        ArcsRange GetIncidentArcs(VertexId vertex) const;
+        // Входящие ребра вершины, vertex - начало ребра
+        ArcsRange GetIncomingArcs(VertexId vertex) const;
 
     private:
+        // Номера ребер выдаются блоками подряд: хранимые ребра или одна линия.
+        // index - номер первого ребра блока в edges_ или номер линии
+        struct EdgeBlock {
+            EdgeId first_edge;
+            size_t index;
+            bool is_line;
+        };
+
+        void CheckFrozenVertex(VertexId vertex) const;
+        const EdgeBlock& FindBlock(EdgeId edge_id) const;
+        const Edge<Weight>& GetStoredEdge(EdgeId edge_id) const;
+        LineEdge DecodeLineEdge(uint32_t line, size_t offset) const;
+        Arc<Weight> MakeLineArc(uint32_t line, uint32_t from_position, uint32_t to_position, bool is_outgoing) const;
+
+        // Номер ребра i -> i + 1 среди ребер линии из size остановок
+        static size_t LineRowStart(size_t size, size_t from_position);
+        static Weight LineWeight(const Line<Weight>& line, size_t from_position, size_t to_position);
+
+        size_t vertex_count_ = 0;
+        size_t edge_count_ = 0;
         std::vector<Edge<Weight>> edges_;
         std::vector<IncidenceList> incidence_lists_;
+        std::vector<Line<Weight>> lines_;
+        std::vector<EdgeId> line_first_edges_;
+        std::vector<EdgeBlock> edge_blocks_;
+
+        bool is_frozen_ = false;
+        std::vector<size_t> out_offsets_;
+        std::vector<EdgeId> out_edges_;
+        std::vector<Arc<Weight>> out_arcs_;
+        std::vector<size_t> in_offsets_;
+        std::vector<Arc<Weight>> in_arcs_;
+        std::vector<size_t> line_out_offsets_;
+        std::vector<LinePosition> line_out_positions_;
+        std::vector<size_t> line_in_offsets_;
+        std::vector<LinePosition> line_in_positions_;
     };
 
     template <typename Weight>
     DirectedWeightedGraph<Weight>::DirectedWeightedGraph(size_t vertex_count)
-        : incidence_lists_(vertex_count) {
+        : vertex_count_(vertex_count)
+        , incidence_lists_(vertex_count) {
     }
 
+
     template <typename Weight>
     EdgeId DirectedWeightedGraph<Weight>::AddEdge(const Edge<Weight>& edge) {
+        if (is_frozen_) {
+            throw std::logic_error("Cannot add an edge to a frozen graph");
+        }
+        if (edge_count_ >= std::numeric_limits<EdgeId>::max()) {
+            throw std::length_error("Too many edges in graph");
+        }
+        if (edge_blocks_.empty() || edge_blocks_.back().is_line) {
+            edge_blocks_.push_back({static_cast<EdgeId>(edge_count_), edges_.size(), false});
+        }
         edges_.push_back(edge);
-        const EdgeId id = edges_.size() - 1;
+        const EdgeId id = static_cast<EdgeId>(edge_count_++);
         incidence_lists_.at(edge.from).push_back(id);
         return id;
     }
 
+    template <typename Weight>
+    EdgeId DirectedWeightedGraph<Weight>::AddLine(Line<Weight> line) {
+        if (is_frozen_) {
+            throw std::logic_error("Cannot add a line to a frozen graph");
+        }
+        const size_t size = line.departures.size();
+        if (line.arrivals.size() != size || line.offsets.size() != size) {
+            throw std::invalid_argument("Line departures, arrivals and offsets should have equal sizes");
+        }
+        for (size_t position = 0; position < size; ++position) {
+            if (line.departures[position] >= vertex_count_ || line.arrivals[position] >= vertex_count_) {
+                throw std::out_of_range("Line vertex id is out of range");
+            }
+        }
+        const size_t edge_count = LineRowStart(size, size == 0 ? 0 : size - 1);
+        if (edge_count >= std::numeric_limits<EdgeId>::max() - edge_count_) {
+            throw std::length_error("Too many edges in graph");
+        }
+        const auto first_edge = static_cast<EdgeId>(edge_count_);
+        edge_blocks_.push_back({first_edge, lines_.size(), true});
+        line_first_edges_.push_back(first_edge);
+        lines_.push_back(std::move(line));
+        edge_count_ += edge_count;
+        return first_edge;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::ReserveEdges(size_t edge_count) {
+        edges_.reserve(edge_count);
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Freeze() {
+        if (is_frozen_) {
+            return;
+        }
+        out_offsets_.assign(vertex_count_ + 1, 0);
+        in_offsets_.assign(vertex_count_ + 1, 0);
+        for (const auto& edge : edges_) {
+            ++out_offsets_[edge.from + 1];
+            ++in_offsets_[edge.to + 1];
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            out_offsets_[vertex + 1] += out_offsets_[vertex];
+            in_offsets_[vertex + 1] += in_offsets_[vertex];
+        }
+
+        // Исходящие ребра сохраняют порядок добавления, как и в списках смежности
+        out_edges_.resize(edges_.size());
+        out_arcs_.resize(edges_.size());
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            size_t position = out_offsets_[vertex];
+            for (const EdgeId edge_id : incidence_lists_[vertex]) {
+                const auto& edge = GetStoredEdge(edge_id);
+                out_edges_[position] = edge_id;
+                out_arcs_[position] = {edge_id, edge.to, edge.weight};
+                ++position;
+            }
+        }
+
+        in_arcs_.resize(edges_.size());
+        std::vector<size_t> in_positions(in_offsets_.begin(), std::prev(in_offsets_.end()));
+        for (size_t block = 0; block < edge_blocks_.size(); ++block) {
+            const EdgeBlock& edge_block = edge_blocks_[block];
+            if (edge_block.is_line) {
+                continue;
+            }
+            const size_t block_end = block + 1 < edge_blocks_.size() ? edge_blocks_[block + 1].first_edge : edge_count_;
+            for (size_t offset = 0; offset < block_end - edge_block.first_edge; ++offset) {
+                const auto& edge = edges_[edge_block.index + offset];
+                in_arcs_[in_positions[edge.to]++] = {static_cast<EdgeId>(edge_block.first_edge + offset),
+                                                     edge.from, edge.weight};
+            }
+        }
+
+        // С позиции линии есть исходящие ребра, если она не последняя, и входящие, если не первая
+        line_out_offsets_.assign(vertex_count_ + 1, 0);
+        line_in_offsets_.assign(vertex_count_ + 1, 0);
+        for (const auto& line : lines_) {
+            for (size_t position = 0; position < line.departures.size(); ++position) {
+                if (position + 1 < line.departures.size()) {
+                    ++line_out_offsets_[line.departures[position] + 1];
+                }
+                if (position > 0) {
+                    ++line_in_offsets_[line.arrivals[position] + 1];
+                }
+            }
+        }
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            line_out_offsets_[vertex + 1] += line_out_offsets_[vertex];
+            line_in_offsets_[vertex + 1] += line_in_offsets_[vertex];
+        }
+        line_out_positions_.resize(line_out_offsets_.back());
+        line_in_positions_.resize(line_in_offsets_.back());
+        std::vector<size_t> line_out_cursors(line_out_offsets_.begin(), std::prev(line_out_offsets_.end()));
+        std::vector<size_t> line_in_cursors(line_in_offsets_.begin(), std::prev(line_in_offsets_.end()));
+        for (uint32_t line_index = 0; line_index < lines_.size(); ++line_index) {
+            const auto& line = lines_[line_index];
+            for (uint32_t position = 0; position < line.departures.size(); ++position) {
+                if (position + 1 < line.departures.size()) {
+                    line_out_positions_[line_out_cursors[line.departures[position]]++] = {line_index, position};
+                }
+                if (position > 0) {
+                    line_in_positions_[line_in_cursors[line.arrivals[position]]++] = {line_index, position};
+                }
+            }
+        }
+
+        std::vector<IncidenceList>().swap(incidence_lists_);
+        is_frozen_ = true;
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::Unfreeze() {
+        if (!is_frozen_) {
+            return;
+        }
+        incidence_lists_.assign(vertex_count_, {});
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            incidence_lists_[vertex].assign(out_edges_.begin() + out_offsets_[vertex],
+                                            out_edges_.begin() + out_offsets_[vertex + 1]);
+        }
+        std::vector<size_t>().swap(out_offsets_);
+        std::vector<EdgeId>().swap(out_edges_);
+        std::vector<Arc<Weight>>().swap(out_arcs_);
+        std::vector<size_t>().swap(in_offsets_);
+        std::vector<Arc<Weight>>().swap(in_arcs_);
+        std::vector<size_t>().swap(line_out_offsets_);
+        std::vector<LinePosition>().swap(line_out_positions_);
+        std::vector<size_t>().swap(line_in_offsets_);
+        std::vector<LinePosition>().swap(line_in_positions_);
+        is_frozen_ = false;
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::IsFrozen() const {
+        return is_frozen_;
+    }
+
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetVertexCount() const {
-        return incidence_lists_.size();
+        return vertex_count_;
     }
 
     template <typename Weight>
     size_t DirectedWeightedGraph<Weight>::GetEdgeCount() const {
-        return edges_.size();
+        return edge_count_;
+    }
+
+    template <typename Weight>
+    Edge<Weight> DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
+        // Без линий номер ребра совпадает с индексом в edges_
+        if (lines_.empty()) {
+            return edges_.at(edge_id);
+        }
+        if (edge_id >= edge_count_) {
+            throw std::out_of_range("Edge id is out of range");
+        }
+        const EdgeBlock& block = FindBlock(edge_id);
+        if (!block.is_line) {
+            return edges_[block.index + (edge_id - block.first_edge)];
+        }
+        const LineEdge line_edge = DecodeLineEdge(static_cast<uint32_t>(block.index), edge_id - block.first_edge);
+        const auto& line = lines_[line_edge.line];
+        return {line.departures[line_edge.from_position], line.arrivals[line_edge.to_position],
+                LineWeight(line, line_edge.from_position, line_edge.to_position)};
     }
 
     template <typename Weight>
-    const Edge<Weight>& DirectedWeightedGraph<Weight>::GetEdge(EdgeId edge_id) const {
-        return edges_.at(edge_id);
+    std::optional<LineEdge> DirectedWeightedGraph<Weight>::GetLineEdge(EdgeId edge_id) const {
+        if (edge_id >= edge_count_) {
+            throw std::out_of_range("Edge id is out of range");
+        }
+        if (lines_.empty()) {
+            return std::nullopt;
+        }
+        const EdgeBlock& block = FindBlock(edge_id);
+        if (!block.is_line) {
+            return std::nullopt;
+        }
+        return DecodeLineEdge(static_cast<uint32_t>(block.index), edge_id - block.first_edge);
     }
 
     template <typename Weight>
     typename DirectedWeightedGraph<Weight>::IncidentEdgesRange
     DirectedWeightedGraph<Weight>::GetIncidentEdges(VertexId vertex) const {
-        return ranges::AsRange(incidence_lists_.at(vertex));
+        if (is_frozen_) {
+            CheckFrozenVertex(vertex);
+            return {out_edges_.data() + out_offsets_[vertex], out_edges_.data() + out_offsets_[vertex + 1]};
+        }
+        const auto& incidence_list = incidence_lists_.at(vertex);
+        return {incidence_list.data(), incidence_list.data() + incidence_list.size()};
+    }
+
+    template <typename Weight>
+    typename DirectedWeightedGraph<Weight>::StoredEdgesRange DirectedWeightedGraph<Weight>::GetStoredEdges() const {
+        return ranges::AsRange(edges_);
+    }
+
+    template <typename Weight>
+    size_t DirectedWeightedGraph<Weight>::GetLineCount() const {
+        return lines_.size();
+    }
+
+    template <typename Weight>
+    const Line<Weight>& DirectedWeightedGraph<Weight>::GetLine(uint32_t line) const {
+        return lines_.at(line);
+    }
+
+    template <typename Weight>
+    EdgeId DirectedWeightedGraph<Weight>::GetLineFirstEdge(uint32_t line) const {
+        return line_first_edges_.at(line);
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::HasNegativeWeights() const {
+        static constexpr Weight ZERO_WEIGHT{};
+        for (const auto& edge : edges_) {
+            if (edge.weight < ZERO_WEIGHT) {
+                return true;
+            }
+        }
+        // Если веса соседних позиций не отрицательны, смещения монотонны в сторону знака делителя,
+        // и остальные разности тоже не отрицательны
+        for (const auto& line : lines_) {
+            for (size_t position = 0; position + 1 < line.offsets.size(); ++position) {
+                if (LineWeight(line, position, position + 1) < ZERO_WEIGHT) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    template <typename Weight>
+    typename DirectedWeightedGraph<Weight>::ArcsRange
+    DirectedWeightedGraph<Weight>::GetIncidentArcs(VertexId vertex) const {
+        CheckFrozenVertex(vertex);
+        const Arc<Weight>* arcs_end = out_arcs_.data() + out_offsets_[vertex + 1];
+        const LinePosition* positions_end = line_out_positions_.data() + line_out_offsets_[vertex + 1];
+        return {ArcIterator(this, true, out_arcs_.data() + out_offsets_[vertex], arcs_end,
+                            line_out_positions_.data() + line_out_offsets_[vertex], positions_end),
+                ArcIterator(this, true, arcs_end, arcs_end, positions_end, positions_end)};
+    }
+
+    template <typename Weight>
+    typename DirectedWeightedGraph<Weight>::ArcsRange
+    DirectedWeightedGraph<Weight>::GetIncomingArcs(VertexId vertex) const {
+        CheckFrozenVertex(vertex);
+        const Arc<Weight>* arcs_end = in_arcs_.data() + in_offsets_[vertex + 1];
+        const LinePosition* positions_end = line_in_positions_.data() + line_in_offsets_[vertex + 1];
+        return {ArcIterator(this, false, in_arcs_.data() + in_offsets_[vertex], arcs_end,
+                            line_in_positions_.data() + line_in_offsets_[vertex], positions_end),
+                ArcIterator(this, false, arcs_end, arcs_end, positions_end, positions_end)};
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::CheckFrozenVertex(VertexId vertex) const {
+        if (!is_frozen_) {
+            throw std::logic_error("Graph should be frozen before iterating over arcs");
+        }
+        if (vertex >= vertex_count_) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+
+    template <typename Weight>
+    const typename DirectedWeightedGraph<Weight>::EdgeBlock&
+    DirectedWeightedGraph<Weight>::FindBlock(EdgeId edge_id) const {
+        const auto next_block = std::upper_bound(
+                edge_blocks_.begin(), edge_blocks_.end(), edge_id,
+                [](EdgeId id, const EdgeBlock& block) {
+                    return id < block.first_edge;
+                });
+        return *std::prev(next_block);
+    }
+
+    template <typename Weight>
+    const Edge<Weight>& DirectedWeightedGraph<Weight>::GetStoredEdge(EdgeId edge_id) const {
+        if (lines_.empty()) {
+            return edges_[edge_id];
+        }
+        const EdgeBlock& block = FindBlock(edge_id);
+        return edges_[block.index + (edge_id - block.first_edge)];
+    }
+
+    template <typename Weight>
+    size_t DirectedWeightedGraph<Weight>::LineRowStart(size_t size, size_t from_position) {
+        return from_position * (2 * size - from_position - 1) / 2;
+    }
+
+    template <typename Weight>
+    Weight DirectedWeightedGraph<Weight>::LineWeight(const Line<Weight>& line, size_t from_position,
+                                                     size_t to_position) {
+        return (line.offsets[to_position] - line.offsets[from_position]) / line.divisor;
+    }
+
+    template <typename Weight>
+    LineEdge DirectedWeightedGraph<Weight>::DecodeLineEdge(uint32_t line, size_t offset) const {
+        // Строка треугольной таблицы ищется двоичным поиском: LineRowStart(low) <= offset < LineRowStart(high)
+        const size_t size = lines_[line].departures.size();
+        size_t low = 0;
+        size_t high = size - 1;
+        while (high - low > 1) {
+            const size_t middle = low + (high - low) / 2;
+            if (LineRowStart(size, middle) <= offset) {
+                low = middle;
+            } else {
+                high = middle;
+            }
+        }
+        return {line, static_cast<uint32_t>(low), static_cast<uint32_t>(low + 1 + offset - LineRowStart(size, low))};
+    }
+
+    template <typename Weight>
+    Arc<Weight> DirectedWeightedGraph<Weight>::MakeLineArc(uint32_t line, uint32_t from_position, uint32_t to_position,
+                                                           bool is_outgoing) const {
+        const auto& line_info = lines_[line];
+        const size_t size = line_info.departures.size();
+        const auto edge_id = static_cast<EdgeId>(line_first_edges_[line] + LineRowStart(size, from_position)
+                                                 + (to_position - from_position - 1));
+        return {edge_id,
+                is_outgoing ? line_info.arrivals[to_position] : line_info.departures[from_position],
+                LineWeight(line_info, from_position, to_position)};
+    }
+
+    template <typename Weight>
+    DirectedWeightedGraph<Weight>::ArcIterator::ArcIterator(
+            const DirectedWeightedGraph* graph, bool is_outgoing, const Arc<Weight>* arc, const Arc<Weight>* arcs_end,
+            const LinePosition* position, const LinePosition* positions_end)
+        : graph_(graph)
+        , is_outgoing_(is_outgoing)
+        , arc_(arc)
+        , arcs_end_(arcs_end)
+        , position_(position)
+        , positions_end_(positions_end) {
+        StartPosition();
+    }
+
+    template <typename Weight>
+    Arc<Weight> DirectedWeightedGraph<Weight>::ArcIterator::operator*() const {
+        if (arc_ != arcs_end_) {
+            return *arc_;
+        }
+        if (is_outgoing_) {
+            return graph_->MakeLineArc(position_->line, position_->position, other_position_, true);
+        }
+        return graph_->MakeLineArc(position_->line, other_position_, position_->position, false);
+    }
+
+    template <typename Weight>
+    typename DirectedWeightedGraph<Weight>::ArcIterator&
+    DirectedWeightedGraph<Weight>::ArcIterator::operator++() {
+        if (arc_ != arcs_end_) {
+            ++arc_;
+            return *this;
+        }
+        const size_t end_position = is_outgoing_ ? graph_->lines_[position_->line].departures.size()
+                                                 : position_->position;
+        if (++other_position_ == end_position) {
+            ++position_;
+            StartPosition();
+        }
+        return *this;
+    }
+
+    template <typename Weight>
+    typename DirectedWeightedGraph<Weight>::ArcIterator
+    DirectedWeightedGraph<Weight>::ArcIterator::operator++(int) {
+        ArcIterator result = *this;
+        ++*this;
+        return result;
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::ArcIterator::operator==(const ArcIterator& other) const {
+        return arc_ == other.arc_ && position_ == other.position_ && other_position_ == other.other_position_;
+    }
+
+    template <typename Weight>
+    bool DirectedWeightedGraph<Weight>::ArcIterator::operator!=(const ArcIterator& other) const {
+        return !(*this == other);
+    }
+
+    template <typename Weight>
+    void DirectedWeightedGraph<Weight>::ArcIterator::StartPosition() {
+        if (position_ == positions_end_) {
+            other_position_ = 0;
+            return;
+        }
+        other_position_ = is_outgoing_ ? position_->position + 1 : 0;
     }
-}  // namespace graph
\ No newline at end of file
+}  // namespace graph
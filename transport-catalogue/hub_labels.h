@@ -0,0 +1,297 @@
+#pragma once
+
+#include "graph.h"
+#include "parallel.h"
+#include "radix_heap.h"
+#include "router.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Метки хабов (pruned landmark labeling). У каждой вершины есть исходящая метка - список хабов,
+// до которых из нее можно доехать, и входящая - список хабов, из которых можно доехать до нее,
+// с весами кратчайших путей. Для любой пары вершин кратчайший путь проходит через общий хаб их меток,
+// поэтому запрос - это слияние двух отсортированных списков. Памяти нужно O(V * размер метки), а не O(V^2).
+// Хабы перебираются по убыванию степени вершины, и из каждого запускается Дейкстра, которая
+// не продолжает путь, если его вес уже получается через хабы, обработанные раньше.
+// Вместе с весом хранится ребро пути к хабу, по этим ребрам маршрут восстанавливается целиком.
+template <typename Weight>
+class HubLabelRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    explicit HubLabelRouter(const Graph& graph);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Только слияние меток, без восстановления маршрутов
+    std::vector<Weight> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                          const std::vector<VertexId>& targets) const override;
+
+    // Средний размер метки, чтобы оценить память и скорость запросов
+    [[nodiscard]] double GetAverageLabelSize() const {
+        const size_t vertex_count = graph_.GetVertexCount();
+        return vertex_count == 0 ? 0.0 : static_cast<double>(out_entries_.size() + in_entries_.size())
+                                         / static_cast<double>(2 * vertex_count);
+    }
+
+private:
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+    static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = InfiniteWeight<Weight>();
+
+    // hub - номер хаба в порядке обработки, поэтому метки отсортированы по нему без дополнительных усилий.
+    // edge - для исходящей метки первое ребро пути к хабу, для входящей - последнее ребро пути от хаба
+    struct LabelEntry {
+        uint32_t hub;
+        EdgeId edge;
+        Weight weight;
+    };
+
+    using Labels = std::vector<std::vector<LabelEntry>>;
+    using LabelRange = ranges::Range<const LabelEntry*>;
+
+    // forward = true - поиск из хаба по исходящим ребрам, заполняет входящие метки
+    void PrunedSearch(VertexId hub_vertex, uint32_t hub, bool forward, Labels& out_labels, Labels& in_labels);
+
+    void PackLabels(Labels& labels, std::vector<size_t>& offsets, std::vector<LabelEntry>& entries);
+
+    LabelRange OutLabel(VertexId vertex) const {
+        return {out_entries_.data() + out_offsets_[vertex], out_entries_.data() + out_offsets_[vertex + 1]};
+    }
+
+    LabelRange InLabel(VertexId vertex) const {
+        return {in_entries_.data() + in_offsets_[vertex], in_entries_.data() + in_offsets_[vertex + 1]};
+    }
+
+    // Общий хаб меток с наименьшим весом пути и этот вес; INFINITE_WEIGHT, если общих хабов нет
+    std::pair<uint32_t, Weight> FindBestHub(VertexId from, VertexId to) const;
+
+    static const LabelEntry& FindEntry(LabelRange label, uint32_t hub) {
+        return *std::lower_bound(label.begin(), label.end(), hub, [](const LabelEntry& entry, uint32_t value) {
+            return entry.hub < value;
+        });
+    }
+
+    const Graph& graph_;
+    std::vector<VertexId> hub_vertices_;
+    std::vector<size_t> out_offsets_;
+    std::vector<LabelEntry> out_entries_;
+    std::vector<size_t> in_offsets_;
+    std::vector<LabelEntry> in_entries_;
+
+    // Состояние поиска при построении: веса до хабов текущей вершины и веса Дейкстры
+    std::vector<Weight> hub_weights_;
+    std::vector<Weight> search_weights_;
+    std::vector<EdgeId> search_edges_;
+};
+
+template <typename Weight>
+HubLabelRouter<Weight>::HubLabelRouter(const Graph& graph)
+    : graph_(graph)
+{
+    if (!graph.IsFrozen()) {
+        throw std::logic_error("Graph should be frozen before building HubLabelRouter");
+    }
+    if (graph.HasNegativeWeights()) {
+        throw std::domain_error("Edges' weights should be non-negative");
+    }
+
+    const size_t vertex_count = graph.GetVertexCount();
+    std::vector<size_t> degrees(vertex_count, 0);
+    for (const auto& edge : graph.GetStoredEdges()) {
+        ++degrees[edge.from];
+        ++degrees[edge.to];
+    }
+    // С позиции линии выходит по ребру в каждую следующую позицию и входит из каждой предыдущей
+    for (uint32_t line_index = 0; line_index < graph.GetLineCount(); ++line_index) {
+        const auto& line = graph.GetLine(line_index);
+        const size_t size = line.departures.size();
+        for (size_t position = 0; position < size; ++position) {
+            degrees[line.departures[position]] += size - 1 - position;
+            degrees[line.arrivals[position]] += position;
+        }
+    }
+    hub_vertices_.resize(vertex_count);
+    std::iota(hub_vertices_.begin(), hub_vertices_.end(), VertexId{0});
+    std::stable_sort(hub_vertices_.begin(), hub_vertices_.end(), [&degrees](VertexId lhs, VertexId rhs) {
+        return degrees[lhs] > degrees[rhs];
+    });
+
+    Labels out_labels(vertex_count);
+    Labels in_labels(vertex_count);
+    hub_weights_.assign(vertex_count, INFINITE_WEIGHT);
+    search_weights_.assign(vertex_count, INFINITE_WEIGHT);
+    search_edges_.assign(vertex_count, NO_EDGE);
+    for (uint32_t hub = 0; hub < vertex_count; ++hub) {
+        PrunedSearch(hub_vertices_[hub], hub, true, out_labels, in_labels);
+        PrunedSearch(hub_vertices_[hub], hub, false, out_labels, in_labels);
+    }
+    std::vector<Weight>().swap(hub_weights_);
+    std::vector<Weight>().swap(search_weights_);
+    std::vector<EdgeId>().swap(search_edges_);
+
+    PackLabels(out_labels, out_offsets_, out_entries_);
+    PackLabels(in_labels, in_offsets_, in_entries_);
+}
+
+template <typename Weight>
+void HubLabelRouter<Weight>::PrunedSearch(VertexId hub_vertex, uint32_t hub, bool forward,
+                                          Labels& out_labels, Labels& in_labels) {
+    // Прямой поиск находит пути hub -> vertex: их проверяем исходящей меткой хаба и входящей меткой вершины
+    auto& hub_label = forward ? out_labels[hub_vertex] : in_labels[hub_vertex];
+    auto& vertex_labels = forward ? in_labels : out_labels;
+    for (const LabelEntry& entry : hub_label) {
+        hub_weights_[entry.hub] = entry.weight;
+    }
+
+    std::vector<VertexId> visited;
+    MinQueue<Weight, VertexId> queue;
+    search_weights_[hub_vertex] = ZERO_WEIGHT;
+    visited.push_back(hub_vertex);
+    queue.push({ZERO_WEIGHT, hub_vertex});
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > search_weights_[vertex]) {
+            continue;
+        }
+        // Путь уже покрыт хабами, обработанными раньше
+        bool is_covered = false;
+        for (const LabelEntry& entry : vertex_labels[vertex]) {
+            if (hub_weights_[entry.hub] != INFINITE_WEIGHT && hub_weights_[entry.hub] + entry.weight <= weight) {
+                is_covered = true;
+                break;
+            }
+        }
+        if (is_covered) {
+            continue;
+        }
+        vertex_labels[vertex].push_back({hub, search_edges_[vertex], weight});
+
+        const auto arcs = forward ? graph_.GetIncidentArcs(vertex) : graph_.GetIncomingArcs(vertex);
+        for (const auto& arc : arcs) {
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < search_weights_[arc.vertex]) {
+                if (search_weights_[arc.vertex] == INFINITE_WEIGHT) {
+                    visited.push_back(arc.vertex);
+                }
+                search_weights_[arc.vertex] = candidate_weight;
+                search_edges_[arc.vertex] = arc.edge_id;
+                queue.push({candidate_weight, arc.vertex});
+            }
+        }
+    }
+
+    for (const VertexId vertex : visited) {
+        search_weights_[vertex] = INFINITE_WEIGHT;
+        search_edges_[vertex] = NO_EDGE;
+    }
+    for (const LabelEntry& entry : hub_label) {
+        hub_weights_[entry.hub] = INFINITE_WEIGHT;
+    }
+}
+
+template <typename Weight>
+void HubLabelRouter<Weight>::PackLabels(Labels& labels, std::vector<size_t>& offsets,
+                                        std::vector<LabelEntry>& entries) {
+    offsets.assign(labels.size() + 1, 0);
+    for (size_t vertex = 0; vertex < labels.size(); ++vertex) {
+        offsets[vertex + 1] = offsets[vertex] + labels[vertex].size();
+    }
+    entries.reserve(offsets.back());
+    for (auto& label : labels) {
+        entries.insert(entries.end(), label.begin(), label.end());
+        std::vector<LabelEntry>().swap(label);
+    }
+}
+
+template <typename Weight>
+std::optional<typename HubLabelRouter<Weight>::RouteInfo> HubLabelRouter<Weight>::BuildRoute(VertexId from,
+                                                                                             VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    const auto [best_hub, best_weight] = FindBestHub(from, to);
+    if (best_weight == INFINITE_WEIGHT) {
+        return std::nullopt;
+    }
+
+    // Путь from -> хаб идет по первым ребрам исходящих меток, путь хаб -> to - по последним ребрам входящих
+    const VertexId hub_vertex = hub_vertices_[best_hub];
+    std::vector<EdgeId> edges;
+    for (VertexId vertex = from; vertex != hub_vertex;) {
+        const EdgeId edge_id = FindEntry(OutLabel(vertex), best_hub).edge;
+        edges.push_back(edge_id);
+        vertex = graph_.GetEdge(edge_id).to;
+    }
+    const size_t hub_position = edges.size();
+    for (VertexId vertex = to; vertex != hub_vertex;) {
+        const EdgeId edge_id = FindEntry(InLabel(vertex), best_hub).edge;
+        edges.push_back(edge_id);
+        vertex = graph_.GetEdge(edge_id).from;
+    }
+    std::reverse(edges.begin() + static_cast<std::ptrdiff_t>(hub_position), edges.end());
+    return RouteInfo{best_weight, std::move(edges)};
+}
+
+template <typename Weight>
+std::vector<Weight> HubLabelRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                              const std::vector<VertexId>& targets) const {
+    for (const VertexId vertex : sources) {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+    for (const VertexId vertex : targets) {
+        if (vertex >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+    }
+    std::vector<Weight> weights(sources.size() * targets.size());
+    parallel::ParallelFor(0, sources.size(), [&](size_t row) {
+        for (size_t column = 0; column < targets.size(); ++column) {
+            weights[row * targets.size() + column] = FindBestHub(sources[row], targets[column]).second;
+        }
+    });
+    return weights;
+}
+
+template <typename Weight>
+std::pair<uint32_t, Weight> HubLabelRouter<Weight>::FindBestHub(VertexId from, VertexId to) const {
+    const LabelRange out_label = OutLabel(from);
+    const LabelRange in_label = InLabel(to);
+    Weight best_weight = INFINITE_WEIGHT;
+    uint32_t best_hub = 0;
+    for (auto out_it = out_label.begin(), in_it = in_label.begin();
+         out_it != out_label.end() && in_it != in_label.end();)
+    {
+        if (out_it->hub < in_it->hub) {
+            ++out_it;
+        } else if (in_it->hub < out_it->hub) {
+            ++in_it;
+        } else {
+            if (out_it->weight + in_it->weight < best_weight) {
+                best_weight = out_it->weight + in_it->weight;
+                best_hub = out_it->hub;
+            }
+            ++out_it;
+            ++in_it;
+        }
+    }
+    return {best_hub, best_weight};
+}
+
+}  // namespace graph
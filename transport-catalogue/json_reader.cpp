@@ -2,6 +2,9 @@
 
 #include <algorithm>
 #include <sstream>
+#include <stdexcept>
+#include <string_view>
+#include <unordered_set>
 
 #include "json_builder.h"
 
@@ -14,19 +17,24 @@ geo::Coordinates ExtractCoordinates(const json::Dict &dict) {
     return {dict.at("latitude").AsDouble(), dict.at("longitude").AsDouble()};
 }
 
-void JsonReader::ProcessBaseRequests(TransportCatalogue &db, renderer::MapRenderer &map) const {
+// Функция, которая добавляет в справочник остановки, расстояния и маршруты из массива запросов.
+// Остановки, уже известные справочнику, не добавляются повторно, но их расстояния обновляются
+void ApplyBaseRequests(const json::Array &requests, TransportCatalogue &db, renderer::MapRenderer &map) {
     using namespace std::literals;
-    const auto base_requests = document_.GetRoot().AsDict().at("base_requests"s).AsArray();
+    const auto known_stops = db.GetAllSortedStops();
 
     // Добавляем остановки
-    for (const auto &request: base_requests) {
+    for (const auto &request: requests) {
         if (request.AsDict().at("type"s) == "Stop"s) {
-            db.AddStop(request.AsDict().at("name"s).AsString(), ExtractCoordinates(request.AsDict()));
+            const std::string &stopname = request.AsDict().at("name"s).AsString();
+            if (known_stops.count(stopname) == 0) {
+                db.AddStop(stopname, ExtractCoordinates(request.AsDict()));
+            }
         }
     }
 
     // Добавляем дистанции между остановками
-    for (const auto &request: base_requests) {
+    for (const auto &request: requests) {
         if (request.AsDict().at("type"s) == "Stop"s) {
             std::string stopname = request.AsDict().at("name"s).AsString();
             for (const auto &[name, distance]: request.AsDict().at("road_distances"s).AsDict()) {
@@ -36,7 +44,7 @@ void JsonReader::ProcessBaseRequests(TransportCatalogue &db, renderer::MapRender
     }
 
     // Создаем и добавляем маршруты
-    for (const auto &request: base_requests) {
+    for (const auto &request: requests) {
         if (request.AsDict().at("type"s) == "Bus"s) {
             std::string busname = request.AsDict().at("name"s).AsString();
             std::vector<std::string_view> stops;
@@ -59,6 +67,80 @@ void JsonReader::ProcessBaseRequests(TransportCatalogue &db, renderer::MapRender
     }
 }
 
+void JsonReader::ProcessBaseRequests(TransportCatalogue &db, renderer::MapRenderer &map) const {
+    using namespace std::literals;
+    ApplyBaseRequests(document_.GetRoot().AsDict().at("base_requests"s).AsArray(), db, map);
+}
+
+void JsonReader::ProcessUpdateRequests(TransportCatalogue &db,
+                                       renderer::MapRenderer &map,
+                                       TransportRouter &router) const {
+    using namespace std::literals;
+    const auto &root = document_.GetRoot().AsDict();
+    const auto update_requests = root.find("update_requests"s);
+    if (update_requests == root.end()) {
+        return;
+    }
+
+    const auto known_buses = db.GetAllSortedBuses();
+    std::vector<std::string> new_buses;
+    for (const auto &request: update_requests->second.AsArray()) {
+        if (request.AsDict().at("type"s) == "Bus"s) {
+            const std::string &busname = request.AsDict().at("name"s).AsString();
+            if (known_buses.count(busname) != 0) {
+                throw std::invalid_argument("Bus " + busname + " is already in the catalogue");
+            }
+            new_buses.push_back(busname);
+        }
+    }
+
+    const size_t stops_count = db.GetAllSortedStops().size();
+    ApplyBaseRequests(update_requests->second.AsArray(), db, map);
+
+    // Вершины графа соответствуют остановкам, поэтому новые остановки требуют нового графа
+    if (db.GetAllSortedStops().size() != stops_count) {
+        router.Rebuild(db);
+        return;
+    }
+    router.UpdateDistances(db);
+    for (const std::string &busname: new_buses) {
+        router.AddBus(db, busname);
+    }
+}
+
+// Функция, которая переводит название алгоритма маршрутизации в RoutingStrategy
+RoutingStrategy ExtractRoutingStrategy(const std::string &name) {
+    using namespace std::literals;
+    if (name == "all_pairs"s) {
+        return RoutingStrategy::AllPairs;
+    }
+    if (name == "compact_all_pairs"s) {
+        return RoutingStrategy::CompactAllPairs;
+    }
+    if (name == "dijkstra"s) {
+        return RoutingStrategy::Dijkstra;
+    }
+    if (name == "astar"s) {
+        return RoutingStrategy::AStar;
+    }
+    if (name == "cached_trees"s) {
+        return RoutingStrategy::CachedTrees;
+    }
+    if (name == "contraction_hierarchies"s) {
+        return RoutingStrategy::ContractionHierarchies;
+    }
+    if (name == "hub_labels"s) {
+        return RoutingStrategy::HubLabels;
+    }
+    if (name == "raptor"s) {
+        return RoutingStrategy::Raptor;
+    }
+    if (name == "source_trees"s) {
+        return RoutingStrategy::SourceTrees;
+    }
+    throw std::invalid_argument("Unknown routing strategy: "s + name);
+}
+
 void JsonReader::ProcessRoutingSettings(TransportRouterBuilder &router_builder) const {
     using namespace std::literals;
     const auto routing_settings = document_.GetRoot().AsDict().at("routing_settings"s).AsDict();
@@ -67,6 +149,57 @@ void JsonReader::ProcessRoutingSettings(TransportRouterBuilder &router_builder)
             .SetBusVelocity(static_cast<uint8_t>(routing_settings.at("bus_velocity"s).AsDouble()))
             .SetBusWaitTime(routing_settings.at("bus_wait_time"s).AsInt());
 
+    // Необязательные настройки: по умолчанию используется предподсчет всех пар
+    if (routing_settings.count("routing_strategy"s)) {
+        router_builder.SetRoutingStrategy(
+                ExtractRoutingStrategy(routing_settings.at("routing_strategy"s).AsString()));
+    }
+    if (routing_settings.count("tree_cache_memory_mb"s)) {
+        router_builder.SetTreeCacheMemoryLimit(
+                static_cast<size_t>(routing_settings.at("tree_cache_memory_mb"s).AsInt()) * 1024 * 1024);
+    }
+    if (routing_settings.count("memory_budget_mb"s)) {
+        router_builder.SetMemoryBudget(
+                static_cast<size_t>(routing_settings.at("memory_budget_mb"s).AsInt()) * 1024 * 1024);
+    }
+    if (routing_settings.count("max_transfers"s)) {
+        router_builder.SetMaxTransfers(routing_settings.at("max_transfers"s).AsInt());
+    }
+    if (routing_settings.count("fixed_point_weights"s)) {
+        router_builder.SetFixedPointWeights(routing_settings.at("fixed_point_weights"s).AsBool());
+    }
+    if (routing_settings.count("implicit_bus_edges"s)) {
+        router_builder.SetImplicitBusEdges(routing_settings.at("implicit_bus_edges"s).AsBool());
+    }
+    if (routing_settings.count("router_cache_file"s)) {
+        router_builder.SetRouterCachePath(routing_settings.at("router_cache_file"s).AsString());
+    }
+    if (routing_settings.count("router_cache_verify"s)) {
+        router_builder.SetVerifyRouterCache(routing_settings.at("router_cache_verify"s).AsBool());
+    }
+    // Все запросы уже прочитаны, поэтому начальные остановки маршрутов известны до построения маршрутизатора
+    router_builder.SetRouteOrigins(CollectRouteOrigins());
+}
+
+std::vector<std::string> JsonReader::CollectRouteOrigins() const {
+    using namespace std::literals;
+    const auto &root = document_.GetRoot().AsDict();
+    std::vector<std::string> origins;
+    if (root.count("stat_requests"s) == 0) {
+        return origins;
+    }
+    std::unordered_set<std::string_view> seen;
+    for (const auto &request: root.at("stat_requests"s).AsArray()) {
+        const auto &request_dict = request.AsDict();
+        if (request_dict.at("type"s).AsString() != "Route"s) {
+            continue;
+        }
+        const std::string &stop = request_dict.at("from"s).AsString();
+        if (seen.insert(stop).second) {
+            origins.push_back(stop);
+        }
+    }
+    return origins;
 }
 
 void JsonReader::ProcessStatRequests(const RequestHandler &db, std::ostream &output) const {
@@ -74,6 +207,17 @@ void JsonReader::ProcessStatRequests(const RequestHandler &db, std::ostream &out
     const auto stat_requests = document_.GetRoot().AsDict().at("stat_requests"s).AsArray();
 
     RequestHandler handler(db);
+
+    // Маршруты ищутся одной пачкой: запросы из одной остановки обрабатываются вместе
+    std::vector<TransportRouter::RouteRequest> route_requests;
+    for (const auto &request: stat_requests) {
+        if (request.AsDict().at("type"s).AsString() == "Route"s) {
+            route_requests.push_back({request.AsDict().at("from"s).AsString(), request.AsDict().at("to"s).AsString()});
+        }
+    }
+    auto itineraries = handler.FindItineraries(route_requests);
+    size_t route_index = 0;
+
     json::Builder response_builder{};
     response_builder.StartArray();
     for (const auto &request: stat_requests) {
@@ -111,51 +255,83 @@ void JsonReader::ProcessStatRequests(const RequestHandler &db, std::ostream &out
             handler.RenderMap().Render(ss);
             response_builder.Key("map"s).Value(ss.str());
         } else if (request_type == "Route") {
-            std::string from = request.AsDict().at("from").AsString();
-            std::string to = request.AsDict().at("to").AsString();
-            auto route = handler.FindRoute(from, to);
-            if (!route.has_value()) {
+            const auto &itinerary = itineraries[route_index++];
+            if (!itinerary.has_value()) {
                 response_builder.Key("error_message").Value("not found");
                 response_builder.EndDict();
                 continue;
             }
 
             json::Array items;
-            double total_time = 0.0;
-            items.reserve(route.value().edges.size());
-            for (auto &edge_id: route.value().edges) {
-                const graph::Edge<double> edge = handler.GetRouterGraph().GetEdge(edge_id);
-                if (edge.quality == 0) {
+            items.reserve(itinerary->items.size());
+            for (const RouteItem &item: itinerary->items) {
+                if (item.type == RouteItem::Type::Wait) {
                     items.emplace_back(
                             json::Builder{}
                             .StartDict()
-                                .Key("stop_name"s).Value(edge.name)
-                                .Key("time"s).Value(edge.weight)
+                                .Key("stop_name"s).Value(std::string(item.name))
+                                .Key("time"s).Value(item.time)
                                 .Key("type"s).Value("Wait"s)
                             .EndDict()
                             .Build()
                             );
-
-                    total_time += edge.weight;
                 } else {
                     items.emplace_back(
                             json::Builder{}
                             .StartDict()
-                                .Key("bus"s).Value(edge.name)
-                                .Key("span_count"s).Value(static_cast<int>(edge.quality))
-                                .Key("time"s).Value(edge.weight)
+                                .Key("bus"s).Value(std::string(item.name))
+                                .Key("span_count"s).Value(static_cast<int>(item.span_count))
+                                .Key("time"s).Value(item.time)
                                 .Key("type"s).Value("Bus"s)
                             .EndDict()
                             .Build()
                             );
-
-                    total_time += edge.weight;
                 }
             }
 
             response_builder
-                    .Key("total_time"s).Value(total_time)
+                    .Key("total_time"s).Value(itinerary->total_time)
                     .Key("items"s).Value(items);
+        } else if (request_type == "TimeMatrix"s) {
+            std::vector<std::string_view> stops;
+            for (const auto &stop: request.AsDict().at("stops"s).AsArray()) {
+                stops.push_back(stop.AsString());
+            }
+            try {
+                const auto matrix = handler.FindTimeMatrix(stops);
+                // Только веса, без этапов маршрутов; null - маршрута нет
+                response_builder.Key("times"s).StartArray();
+                for (const auto &row: matrix) {
+                    response_builder.StartArray();
+                    for (const auto &time: row) {
+                        if (time.has_value()) {
+                            response_builder.Value(*time);
+                        } else {
+                            response_builder.Value(nullptr);
+                        }
+                    }
+                    response_builder.EndArray();
+                }
+                response_builder.EndArray();
+            } catch (std::out_of_range &) {
+                response_builder.Key("error_message"s).Value("not found"s);
+            }
+        } else if (request_type == "Isochrone"s) {
+            try {
+                const auto reachable = handler.FindReachableStops(request.AsDict().at("from"s).AsString(),
+                                                                  request.AsDict().at("max_time"s).AsDouble());
+                response_builder.Key("stops"s).StartArray();
+                for (const ReachableStop &stop: reachable) {
+                    response_builder
+                            .StartDict()
+                                .Key("stop_name"s).Value(std::string(stop.name))
+                                .Key("time"s).Value(stop.time)
+                            .EndDict();
+                }
+                response_builder.EndArray();
+            } catch (std::out_of_range &) {
+                response_builder.Key("error_message"s).Value("not found"s);
+            }
         }
         response_builder.EndDict();
     }
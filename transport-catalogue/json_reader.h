@@ -1,6 +1,8 @@
 #pragma once
 
 #include <istream>
+#include <string>
+#include <vector>
 
 #include "json.h"
 #include "request_handler.h"
@@ -16,6 +18,11 @@ public:
     // Метод обработки Base запросов
     void ProcessBaseRequests(TransportCatalogue &db, renderer::MapRenderer& map) const;
 
+    // Метод обработки необязательных запросов update_requests: добавляет в справочник новые остановки,
+    // расстояния и маршруты после построения маршрутизатора и обновляет его без полной перестройки,
+    // если это возможно. Маршруты с уже известными названиями не принимаются
+    void ProcessUpdateRequests(TransportCatalogue &db, renderer::MapRenderer& map, TransportRouter& router) const;
+
     void ProcessRoutingSettings(TransportRouterBuilder& router_builder) const;
 
     // Метод обработки Stat запросов
@@ -25,5 +32,8 @@ public:
     [[nodiscard]] renderer::Settings GetRenderSettings() const;
 
 private:
+    // Различные начальные остановки запросов Route в порядке появления
+    [[nodiscard]] std::vector<std::string> CollectRouteOrigins() const;
+
     json::Document document_{{}};
 };
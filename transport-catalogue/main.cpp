@@ -31,6 +31,11 @@ int main() {
     TransportRouterBuilder router_builder(catalogue);
     reader.ProcessRoutingSettings(router_builder);
     TransportRouter router = router_builder.Build();
+    reader.ProcessUpdateRequests(
+            catalogue,
+            renderer,
+            router
+            );
     RequestHandler handler(catalogue, renderer, router);
     reader.ProcessStatRequests(
             handler,
@@ -40,4 +45,12 @@ int main() {
             ofile
 #endif
             );
+#ifdef Debug
+    if (const auto stats = router.GetTreeCacheStats()) {
+        cerr << "Tree cache: hits "s << stats->hits << ", misses "s << stats->misses
+             << ", evictions "s << stats->evictions << ", invalidations "s << stats->invalidations
+             << ", cached "s << stats->cached_trees
+             << '/' << stats->capacity << endl;
+    }
+#endif
 }
@@ -0,0 +1,112 @@
+#include "min_plus.h"
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MIN_PLUS_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace min_plus {
+
+    namespace {
+        using Kernel = void (*)(double, const double *, const uint32_t *, double *, uint32_t *, size_t);
+
+        void RelaxRowScalar(double weight_through, const double *row_through, const uint32_t *prev_through,
+                            double *row_from, uint32_t *prev_from, size_t count) {
+            for (size_t i = 0; i < count; ++i) {
+                const double candidate = weight_through + row_through[i];
+                if (candidate < row_from[i]) {
+                    row_from[i] = candidate;
+                    prev_from[i] = prev_through[i];
+                }
+            }
+        }
+
+#ifdef MIN_PLUS_X86_KERNELS
+        __attribute__((target("avx2")))
+        void RelaxRowAvx2(double weight_through, const double *row_through, const uint32_t *prev_through,
+                          double *row_from, uint32_t *prev_from, size_t count) {
+            const __m256d through = _mm256_set1_pd(weight_through);
+            // Младшие 32 бита каждой 64-битной маски сравнения - маска для номеров ребер
+            const __m256i mask_lanes = _mm256_setr_epi32(0, 2, 4, 6, 0, 0, 0, 0);
+            size_t i = 0;
+            for (; i + 4 <= count; i += 4) {
+                const __m256d candidate = _mm256_add_pd(through, _mm256_loadu_pd(row_through + i));
+                const __m256d current = _mm256_loadu_pd(row_from + i);
+                const __m256d is_better = _mm256_cmp_pd(candidate, current, _CMP_LT_OQ);
+                if (_mm256_movemask_pd(is_better) == 0) {
+                    continue;
+                }
+                _mm256_storeu_pd(row_from + i, _mm256_blendv_pd(current, candidate, is_better));
+
+                const __m128i prev_mask = _mm256_castsi256_si128(
+                        _mm256_permutevar8x32_epi32(_mm256_castpd_si256(is_better), mask_lanes));
+                const __m128i prev_current = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev_from + i));
+                const __m128i prev_candidate = _mm_loadu_si128(reinterpret_cast<const __m128i *>(prev_through + i));
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(prev_from + i),
+                                 _mm_blendv_epi8(prev_current, prev_candidate, prev_mask));
+            }
+            RelaxRowScalar(weight_through, row_through + i, prev_through + i, row_from + i, prev_from + i, count - i);
+        }
+
+        __attribute__((target("avx512f,avx512vl")))
+        void RelaxRowAvx512(double weight_through, const double *row_through, const uint32_t *prev_through,
+                            double *row_from, uint32_t *prev_from, size_t count) {
+            const __m512d through = _mm512_set1_pd(weight_through);
+            size_t i = 0;
+            for (; i + 8 <= count; i += 8) {
+                const __m512d candidate = _mm512_add_pd(through, _mm512_loadu_pd(row_through + i));
+                const __m512d current = _mm512_loadu_pd(row_from + i);
+                const __mmask8 is_better = _mm512_cmp_pd_mask(candidate, current, _CMP_LT_OQ);
+                if (is_better == 0) {
+                    continue;
+                }
+                _mm512_mask_storeu_pd(row_from + i, is_better, candidate);
+                _mm256_mask_storeu_epi32(prev_from + i, is_better,
+                                         _mm256_loadu_si256(reinterpret_cast<const __m256i *>(prev_through + i)));
+            }
+            // Хвост строки обрабатывается той же маской, ограниченной оставшимися ячейками
+            if (i < count) {
+                const auto tail = static_cast<__mmask8>((1u << (count - i)) - 1);
+                const __m512d candidate = _mm512_add_pd(through, _mm512_maskz_loadu_pd(tail, row_through + i));
+                const __m512d current = _mm512_maskz_loadu_pd(tail, row_from + i);
+                const __mmask8 is_better = _mm512_mask_cmp_pd_mask(tail, candidate, current, _CMP_LT_OQ);
+                _mm512_mask_storeu_pd(row_from + i, is_better, candidate);
+                _mm256_mask_storeu_epi32(prev_from + i, is_better, _mm256_maskz_loadu_epi32(tail, prev_through + i));
+            }
+        }
+#endif
+
+        struct SelectedKernel {
+            Kernel kernel;
+            const char *name;
+        };
+
+        SelectedKernel SelectKernel() {
+#ifdef MIN_PLUS_X86_KERNELS
+            __builtin_cpu_init();
+            if (__builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")) {
+                return {RelaxRowAvx512, "avx512"};
+            }
+            if (__builtin_cpu_supports("avx2")) {
+                return {RelaxRowAvx2, "avx2"};
+            }
+#endif
+            return {RelaxRowScalar, "scalar"};
+        }
+
+        const SelectedKernel &GetSelectedKernel() {
+            static const SelectedKernel selected = SelectKernel();
+            return selected;
+        }
+    }
+
+    void RelaxRow(double weight_through, const double *row_through, const uint32_t *prev_through,
+                  double *row_from, uint32_t *prev_from, size_t count) {
+        GetSelectedKernel().kernel(weight_through, row_through, prev_through, row_from, prev_from, count);
+    }
+
+    const char *GetKernelName() {
+        return GetSelectedKernel().name;
+    }
+
+}  // namespace min_plus
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+// Векторизованная релаксация строки матрицы кратчайших путей (умножение в полукольце min-plus)
+namespace min_plus {
+
+    // Для каждого i из [0, count): если weight_through + row_through[i] < row_from[i],
+    // то row_from[i] = weight_through + row_through[i] и prev_from[i] = prev_through[i].
+    // Недостижимые ячейки хранят +infinity: сумма с бесконечностью не меньше текущего значения,
+    // поэтому отдельная проверка не нужна. Строки могут совпадать, только если weight_through = 0:
+    // тогда ни одна ячейка не меняется.
+    // Ядро (AVX-512, AVX2 или скалярное) выбирается один раз по возможностям процессора
+    void RelaxRow(double weight_through, const double *row_through, const uint32_t *prev_through,
+                  double *row_from, uint32_t *prev_from, size_t count);
+
+    // Название выбранного ядра: "avx512", "avx2" или "scalar"
+    const char *GetKernelName();
+
+}  // namespace min_plus
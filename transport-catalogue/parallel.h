@@ -0,0 +1,65 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel {
+
+    // Количество потоков, на которое имеет смысл делить работу
+    inline size_t GetThreadCount() {
+        return std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+
+    // Вызывает func(index) для каждого index из [begin, end) на всех доступных ядрах.
+    // Индексы раздаются потокам по одному, поэтому задачи разной длительности распределяются равномерно.
+    // Первое исключение из func пробрасывается вызывающему после завершения всех потоков.
+    template <typename Func>
+    void ParallelFor(size_t begin, size_t end, Func func) {
+        if (begin >= end) {
+            return;
+        }
+        const size_t thread_count = std::min(GetThreadCount(), end - begin);
+        if (thread_count == 1) {
+            for (size_t index = begin; index < end; ++index) {
+                func(index);
+            }
+            return;
+        }
+
+        std::atomic<size_t> next_index{begin};
+        std::exception_ptr exception;
+        std::mutex exception_mutex;
+        const auto worker = [&]() {
+            try {
+                for (size_t index = next_index++; index < end; index = next_index++) {
+                    func(index);
+                }
+            } catch (...) {
+                std::lock_guard guard(exception_mutex);
+                if (!exception) {
+                    exception = std::current_exception();
+                }
+                next_index = end;
+            }
+        };
+
+        std::vector<std::thread> threads;
+        threads.reserve(thread_count - 1);
+        for (size_t i = 1; i < thread_count; ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (auto& thread : threads) {
+            thread.join();
+        }
+        if (exception) {
+            std::rethrow_exception(exception);
+        }
+    }
+
+}  // namespace parallel
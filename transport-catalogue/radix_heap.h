@@ -0,0 +1,113 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Монотонная очередь с приоритетом для беззнаковых целых ключей.
+// Извлекаемые ключи не убывают, поэтому новый ключ не может быть меньше текущего минимума:
+// это выполняется в алгоритме Дейкстры при неотрицательных весах.
+// Элемент с ключом key лежит в корзине по номеру старшего бита, в котором key отличается
+// от последнего извлеченного ключа, и за все время перекладывается не больше числа бит ключа раз.
+// Интерфейс совпадает с нужной частью std::priority_queue.
+template <typename Key, typename Value>
+class RadixHeap {
+    static_assert(std::is_unsigned_v<Key>, "RadixHeap keys should be unsigned integers");
+
+public:
+    using Item = std::pair<Key, Value>;
+
+    bool empty() const {
+        return size_ == 0;
+    }
+
+    size_t size() const {
+        return size_;
+    }
+
+    // Минимальные элементы лежат в нулевой корзине, ее при необходимости заполняет Redistribute.
+    // Корзины перекладываются и в константном методе: для пользователя очередь от этого не меняется
+    const Item& top() const {
+        if (buckets_[0].empty()) {
+            Redistribute();
+        }
+        return buckets_[0].back();
+    }
+
+    void push(const Item& item) {
+        assert(item.first >= last_);
+        buckets_[BucketIndex(item.first)].push_back(item);
+        ++size_;
+    }
+
+    void pop() {
+        if (buckets_[0].empty()) {
+            Redistribute();
+        }
+        buckets_[0].pop_back();
+        --size_;
+    }
+
+private:
+    static constexpr size_t KEY_BITS = std::numeric_limits<Key>::digits;
+
+    size_t BucketIndex(Key key) const {
+        const Key diff = key ^ last_;
+        if (diff == 0) {
+            return 0;
+        }
+#if defined(__GNUC__) || defined(__clang__)
+        return std::numeric_limits<unsigned long long>::digits
+               - static_cast<size_t>(__builtin_clzll(static_cast<unsigned long long>(diff)));
+#else
+        size_t width = 0;
+        for (Key rest = diff; rest != 0; rest >>= 1) {
+            ++width;
+        }
+        return width;
+#endif
+    }
+
+    // Новый последний ключ - минимум первой непустой корзины, и все ее элементы уходят в корзины с меньшими номерами
+    void Redistribute() const {
+        size_t index = 1;
+        while (buckets_[index].empty()) {
+            ++index;
+        }
+        std::vector<Item> bucket;
+        bucket.swap(buckets_[index]);
+        last_ = bucket.front().first;
+        for (const Item& item : bucket) {
+            last_ = std::min(last_, item.first);
+        }
+        for (const Item& item : bucket) {
+            buckets_[BucketIndex(item.first)].push_back(item);
+        }
+        // Все элементы ушли в корзины с меньшими номерами, возвращаем корзине ее память
+        bucket.clear();
+        buckets_[index].swap(bucket);
+    }
+
+    mutable std::array<std::vector<Item>, KEY_BITS + 1> buckets_;
+    mutable Key last_{};
+    size_t size_ = 0;
+};
+
+// Очередь для алгоритма Дейкстры: для беззнаковых целых весов - RadixHeap, для остальных - двоичная куча
+template <typename Weight, typename Value>
+using MinQueue = std::conditional_t<std::is_integral_v<Weight> && std::is_unsigned_v<Weight>,
+                                    RadixHeap<Weight, Value>,
+                                    std::priority_queue<std::pair<Weight, Value>,
+                                                        std::vector<std::pair<Weight, Value>>,
+                                                        std::greater<>>>;
+
+}  // namespace graph
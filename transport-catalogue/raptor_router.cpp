@@ -0,0 +1,228 @@
+#include "raptor_router.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+    constexpr double INFINITE_TIME = std::numeric_limits<double>::infinity();
+    constexpr uint32_t NO_POSITION = std::numeric_limits<uint32_t>::max();
+}
+
+RaptorRouter::RaptorRouter(
+        const TransportCatalogue &catalogue,
+        uint8_t bus_wait_time,
+        double bus_velocity
+        ) : bus_wait_time_(bus_wait_time), bus_velocity_(bus_velocity) {
+    for (const auto &[stop_name, stop_info]: catalogue.GetAllSortedStops()) {
+        stop_indices_[stop_info->name_] = static_cast<StopIndex>(stops_.size());
+        stops_.push_back(stop_info);
+    }
+    stop_lines_.resize(stops_.size());
+
+    for (const auto &[bus_name, bus_info]: catalogue.GetAllSortedBuses()) {
+        const auto &route = bus_info->route_;
+        const size_t stops_count = route.size();
+        if (stops_count < 2) {
+            continue;
+        }
+
+        std::vector<StopIndex> stops(stops_count);
+        std::vector<size_t> distances(stops_count);
+        for (size_t i = 0; i < stops_count; ++i) {
+            stops[i] = stop_indices_.at(route[i]->name_);
+            distances[i] = catalogue.RouteDistance(bus_info, 0, i);
+        }
+        AddLine(bus_info, stops, std::move(distances));
+
+        // Для некольцевого маршрута граф TransportRouter содержит и ребра в обратную сторону
+        if (!bus_info->is_roundtrip_) {
+            std::vector<size_t> inverse_distances(stops_count);
+            for (size_t i = 0; i < stops_count; ++i) {
+                inverse_distances[i] = catalogue.RouteDistance(bus_info, stops_count - 1, stops_count - 1 - i);
+            }
+            std::reverse(stops.begin(), stops.end());
+            AddLine(bus_info, std::move(stops), std::move(inverse_distances));
+        }
+    }
+}
+
+void RaptorRouter::AddLine(const Bus *bus, std::vector<StopIndex> stops, std::vector<size_t> distances) {
+    const auto line_index = static_cast<LineIndex>(lines_.size());
+    for (uint32_t position = 0; position < stops.size(); ++position) {
+        stop_lines_[stops[position]].push_back({line_index, position});
+    }
+    lines_.push_back({bus, std::move(stops), std::move(distances)});
+}
+
+double RaptorRouter::RideTime(const Line &line, uint32_t board_position, uint32_t alight_position) const {
+    return static_cast<double>(line.distances[alight_position] - line.distances[board_position])
+           / (bus_velocity_ * (100.0 / 6.0));
+}
+
+std::optional<Itinerary> RaptorRouter::FindRoute(
+        std::string_view stop_from,
+        std::string_view stop_to,
+        size_t max_transfers
+        ) const {
+    const StopIndex from = stop_indices_.at(stop_from);
+    const StopIndex to = stop_indices_.at(stop_to);
+    if (from == to) {
+        return Itinerary{0.0, {}};
+    }
+
+    const SearchResult result = Search(from, to, max_transfers);
+    if (result.arrivals.back()[to] == INFINITE_TIME) {
+        return std::nullopt;
+    }
+    return BuildItinerary(result.labels, result.round, to);
+}
+
+std::vector<double> RaptorRouter::FindTimes(
+        std::string_view stop_from,
+        const std::vector<std::string_view> &stops_to,
+        size_t max_transfers
+        ) const {
+    const StopIndex from = stop_indices_.at(stop_from);
+    std::vector<StopIndex> targets;
+    targets.reserve(stops_to.size());
+    for (const std::string_view stop_to: stops_to) {
+        targets.push_back(stop_indices_.at(stop_to));
+    }
+
+    const SearchResult result = Search(from, std::nullopt, max_transfers);
+    std::vector<double> times;
+    times.reserve(targets.size());
+    for (const StopIndex to: targets) {
+        times.push_back(result.arrivals.back()[to]);
+    }
+    return times;
+}
+
+std::vector<ReachableStop> RaptorRouter::FindReachableStops(
+        std::string_view stop_from,
+        double max_time,
+        size_t max_transfers
+        ) const {
+    const SearchResult result = Search(stop_indices_.at(stop_from), std::nullopt, max_transfers, max_time);
+    std::vector<ReachableStop> reachable;
+    for (StopIndex stop = 0; stop < stops_.size(); ++stop) {
+        if (result.arrivals.back()[stop] <= max_time) {
+            reachable.push_back({stops_[stop]->name_, result.arrivals.back()[stop]});
+        }
+    }
+    // Остановки пронумерованы по алфавиту, поэтому при равном времени порядок - по названию
+    std::stable_sort(reachable.begin(), reachable.end(), [](const ReachableStop &lhs, const ReachableStop &rhs) {
+        return lhs.time < rhs.time;
+    });
+    return reachable;
+}
+
+RaptorRouter::SearchResult RaptorRouter::Search(
+        StopIndex from,
+        std::optional<StopIndex> to,
+        size_t max_transfers,
+        double max_time
+        ) const {
+    // В раунде k находится лучшее время прибытия не более чем с k поездками
+    const size_t max_rounds = max_transfers < stops_.size() ? max_transfers + 1 : stops_.size();
+    std::vector<std::vector<double>> arrivals{std::vector<double>(stops_.size(), INFINITE_TIME)};
+    std::vector<std::vector<Label>> labels{std::vector<Label>(stops_.size())};
+    arrivals[0][from] = 0.0;
+
+    std::vector<StopIndex> marked_stops{from};
+    std::vector<bool> is_marked(stops_.size(), false);
+    std::vector<uint32_t> line_starts(lines_.size(), NO_POSITION);
+    std::vector<LineIndex> touched_lines;
+
+    size_t round = 0;
+    while (round < max_rounds && !marked_stops.empty()) {
+        ++round;
+
+        // Маршруты, проходящие через улучшенные остановки, просматриваются с самой ранней из них
+        for (const StopIndex stop: marked_stops) {
+            is_marked[stop] = false;
+            for (const auto &[line, position]: stop_lines_[stop]) {
+                if (line_starts[line] == NO_POSITION) {
+                    touched_lines.push_back(line);
+                }
+                line_starts[line] = std::min(line_starts[line], position);
+            }
+        }
+        marked_stops.clear();
+
+        arrivals.push_back(arrivals.back());
+        labels.emplace_back(stops_.size());
+        const auto &previous = arrivals[round - 1];
+        auto &current = arrivals[round];
+
+        for (const LineIndex line_index: touched_lines) {
+            const Line &line = lines_[line_index];
+            uint32_t board_position = NO_POSITION;
+            for (uint32_t position = line_starts[line_index]; position < line.stops.size(); ++position) {
+                const StopIndex stop = line.stops[position];
+                if (board_position != NO_POSITION) {
+                    const double arrival = previous[line.stops[board_position]] + bus_wait_time_
+                                           + RideTime(line, board_position, position);
+                    // Отсекаем прибытия, которые не лучше уже найденного маршрута до цели
+                    if (arrival < current[stop] && arrival <= max_time && (!to || arrival < current[*to])) {
+                        current[stop] = arrival;
+                        labels[round][stop] = {line_index, board_position, position};
+                        if (!is_marked[stop]) {
+                            is_marked[stop] = true;
+                            marked_stops.push_back(stop);
+                        }
+                    }
+                }
+                // Садимся здесь, если на эту остановку попали раньше, чем сюда доедет текущий автобус
+                if (previous[stop] != INFINITE_TIME
+                    && (board_position == NO_POSITION
+                        || previous[stop] < previous[line.stops[board_position]]
+                                            + RideTime(line, board_position, position))) {
+                    board_position = position;
+                }
+            }
+            line_starts[line_index] = NO_POSITION;
+        }
+        touched_lines.clear();
+    }
+
+    return {std::move(arrivals), std::move(labels), round};
+}
+
+Itinerary RaptorRouter::BuildItinerary(
+        const std::vector<std::vector<Label>> &labels,
+        size_t round,
+        StopIndex stop_to
+        ) const {
+    std::vector<RouteItem> items;
+    StopIndex stop = stop_to;
+    while (round > 0) {
+        // Время прибытия могло остаться с предыдущих раундов
+        while (round > 0 && labels[round][stop].line == Label::NO_LINE) {
+            --round;
+        }
+        if (round == 0) {
+            break;
+        }
+        const Label &label = labels[round][stop];
+        const Line &line = lines_[label.line];
+        const StopIndex board_stop = line.stops[label.board_position];
+        items.push_back({line.bus->name_,
+                         RideTime(line, label.board_position, label.alight_position),
+                         label.alight_position - label.board_position,
+                         RouteItem::Type::Bus});
+        items.push_back({stops_[board_stop]->name_,
+                         bus_wait_time_,
+                         0,
+                         RouteItem::Type::Wait});
+        stop = board_stop;
+        --round;
+    }
+    std::reverse(items.begin(), items.end());
+
+    double total_time = 0.0;
+    for (const RouteItem &item: items) {
+        total_time += item.time;
+    }
+    return {total_time, std::move(items)};
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "domain.h"
+#include "transport_catalogue.h"
+
+// Поиск маршрутов по раундам в стиле RAPTOR прямо по маршрутам автобусов из справочника.
+// В отличие от графа TransportRouter здесь не создаются ребра для каждой пары остановок автобуса:
+// раунд k просматривает маршруты, проходящие через остановки, улучшенные в раунде k - 1,
+// и находит лучшее время прибытия с k поездками. Поэтому легко ограничить число пересадок.
+class RaptorRouter final {
+public:
+    static constexpr size_t UNLIMITED_TRANSFERS = std::numeric_limits<size_t>::max();
+
+    RaptorRouter(const TransportCatalogue &catalogue, uint8_t bus_wait_time, double bus_velocity);
+
+    // Кратчайший по времени маршрут, в котором не больше max_transfers пересадок
+    [[nodiscard]] std::optional<Itinerary> FindRoute(std::string_view stop_from, std::string_view stop_to,
+                                                     size_t max_transfers = UNLIMITED_TRANSFERS) const;
+
+    // Время в пути из stop_from до каждой из stops_to за один поиск из stop_from без цели.
+    // Бесконечность - остановка недостижима
+    [[nodiscard]] std::vector<double> FindTimes(std::string_view stop_from, const std::vector<std::string_view> &stops_to,
+                                                size_t max_transfers = UNLIMITED_TRANSFERS) const;
+
+    // Остановки, до которых из stop_from можно доехать не дольше чем за max_time, по возрастанию времени
+    [[nodiscard]] std::vector<ReachableStop> FindReachableStops(std::string_view stop_from, double max_time,
+                                                                size_t max_transfers = UNLIMITED_TRANSFERS) const;
+
+private:
+    using StopIndex = uint32_t;
+    using LineIndex = uint32_t;
+
+    // Направление движения автобуса: последовательность остановок и расстояния от начала
+    struct Line {
+        const Bus *bus;
+        std::vector<StopIndex> stops;
+        std::vector<size_t> distances;
+    };
+
+    struct LinePosition {
+        LineIndex line;
+        uint32_t position;
+    };
+
+    // Как получено время прибытия на остановку в раунде: поездка на линии от посадки до высадки
+    struct Label {
+        static constexpr LineIndex NO_LINE = std::numeric_limits<LineIndex>::max();
+
+        LineIndex line = NO_LINE;
+        uint32_t board_position = 0;
+        uint32_t alight_position = 0;
+    };
+
+    // Времена прибытия и способ прибытия на остановки по раундам
+    struct SearchResult {
+        std::vector<std::vector<double>> arrivals;
+        std::vector<std::vector<Label>> labels;
+        size_t round;
+    };
+
+    // Раунды поиска из from. Если задана цель to, прибытия не лучше уже найденного до нее отсекаются,
+    // прибытия позже max_time отсекаются всегда
+    [[nodiscard]] SearchResult Search(StopIndex from, std::optional<StopIndex> to, size_t max_transfers,
+                                      double max_time = std::numeric_limits<double>::infinity()) const;
+
+    void AddLine(const Bus *bus, std::vector<StopIndex> stops, std::vector<size_t> distances);
+
+    [[nodiscard]] double RideTime(const Line &line, uint32_t board_position, uint32_t alight_position) const;
+
+    [[nodiscard]] Itinerary BuildItinerary(const std::vector<std::vector<Label>> &labels, size_t round,
+                                           StopIndex stop_to) const;
+
+    double bus_wait_time_;
+    double bus_velocity_;
+
+    std::vector<const Stop *> stops_;
+    std::unordered_map<std::string_view, StopIndex> stop_indices_;
+    std::vector<Line> lines_;
+    std::vector<std::vector<LinePosition>> stop_lines_;
+};
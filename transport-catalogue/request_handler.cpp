@@ -26,6 +26,20 @@ std::optional<TransportRouter::RouteInfo> RequestHandler::FindRoute(std::string_
     return router_.FindRoute(from, to);
 }
 
-TransportRouter::Graph RequestHandler::GetRouterGraph() const {
-    return router_.GetGraph();
+std::optional<Itinerary> RequestHandler::FindItinerary(std::string_view from, std::string_view to) const {
+    return router_.FindItinerary(from, to);
+}
+
+std::vector<std::optional<Itinerary>> RequestHandler::FindItineraries(
+        const std::vector<TransportRouter::RouteRequest> &requests) const {
+    return router_.FindItineraries(requests);
+}
+
+std::vector<std::vector<std::optional<double>>> RequestHandler::FindTimeMatrix(
+        const std::vector<std::string_view> &stops) const {
+    return router_.FindTimeMatrix(stops);
+}
+
+std::vector<ReachableStop> RequestHandler::FindReachableStops(std::string_view from, double max_time) const {
+    return router_.FindReachableStops(from, max_time);
 }
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <optional>
+#include <vector>
 
 #include "map_renderer.h"
 #include "svg.h"
@@ -26,7 +27,18 @@ public:
 
     [[nodiscard]] std::optional<TransportRouter::RouteInfo> FindRoute(std::string_view from, std::string_view to) const;
 
-    [[nodiscard]] TransportRouter::Graph GetRouterGraph() const;
+    [[nodiscard]] std::optional<Itinerary> FindItinerary(std::string_view from, std::string_view to) const;
+
+    // Ответы на несколько запросов Route сразу, в порядке запросов
+    [[nodiscard]] std::vector<std::optional<Itinerary>> FindItineraries(
+            const std::vector<TransportRouter::RouteRequest>& requests) const;
+
+    // Время в пути между всеми парами остановок (запрос TimeMatrix)
+    [[nodiscard]] std::vector<std::vector<std::optional<double>>> FindTimeMatrix(
+            const std::vector<std::string_view>& stops) const;
+
+    // Остановки, до которых можно доехать за max_time минут (запрос Isochrone)
+    [[nodiscard]] std::vector<ReachableStop> FindReachableStops(std::string_view from, double max_time) const;
 
 private:
     // RequestHandler использует агрегацию объектов "Транспортный Справочник" и "Визуализатор Карты"
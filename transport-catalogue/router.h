@@ -1,113 +1,354 @@
 #pragma once
 
 #include "graph.h"
+#include "min_plus.h"
+#include "parallel.h"
 
 #include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iterator>
+#include <limits>
 #include <optional>
 #include <stdexcept>
+#include <type_traits>
 #include <unordered_map>
 #include <utility>
 #include <vector>
 
 namespace graph {
 
+// Общий интерфейс маршрутизаторов, чтобы TransportRouter мог выбирать алгоритм при построении
 template <typename Weight>
-class Router {
+class BaseRouter {
+public:
+    struct RouteInfo {
+        Weight weight;
+        std::vector<EdgeId> edges;
+    };
+
+    virtual ~BaseRouter() = default;
+
+    virtual std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const = 0;
+
+    // Веса маршрутов из каждой вершины sources в каждую вершину targets, построчно:
+    // элемент [i * targets.size() + j] - вес от sources[i] до targets[j], InfiniteWeight - маршрута нет.
+    // По умолчанию - отдельный поиск на каждую пару, строки считаются параллельно
+    virtual std::vector<Weight> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                  const std::vector<VertexId>& targets) const {
+        std::vector<Weight> weights(sources.size() * targets.size(), InfiniteWeight<Weight>());
+        parallel::ParallelFor(0, sources.size(), [&](size_t row) {
+            for (size_t column = 0; column < targets.size(); ++column) {
+                if (const auto route = BuildRoute(sources[row], targets[column])) {
+                    weights[row * targets.size() + column] = route->weight;
+                }
+            }
+        });
+        return weights;
+    }
+
+    // Маршруты из from в каждую вершину targets в том же порядке.
+    // По умолчанию - отдельный поиск на каждую вершину
+    virtual std::vector<std::optional<RouteInfo>> BuildRoutes(VertexId from,
+                                                              const std::vector<VertexId>& targets) const {
+        std::vector<std::optional<RouteInfo>> routes;
+        routes.reserve(targets.size());
+        for (const VertexId to : targets) {
+            routes.push_back(BuildRoute(from, to));
+        }
+        return routes;
+    }
+};
+
+// Предподсчет всех пар вершин алгоритмом Флойда-Уоршелла: O(V^3) времени и O(V^2) памяти.
+// Матрица весов хранится одним непрерывным массивом и обрабатывается блоками BLOCK_SIZE x BLOCK_SIZE:
+// на каждой фазе независимые блоки распределяются между всеми ядрами.
+template <typename Weight>
+class Router final : public BaseRouter<Weight> {
 private:
     using Graph = DirectedWeightedGraph<Weight>;
 
 public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
     explicit Router(const Graph& graph);
+    // Маршрутизатор поверх готовых таблиц размера V x V, например отображенных в память из файла.
+    // Таблицы не копируются и должны пережить маршрутизатор
+    Router(const Graph& graph, const Weight* weights, const EdgeId* prev_edges);
 
-    struct RouteInfo {
-        Weight weight;
-        std::vector<EdgeId> edges;
-    };
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Веса берутся прямо из таблицы
+    std::vector<Weight> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                          const std::vector<VertexId>& targets) const override;
 
-    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const;
+    // Обновляет таблицы после добавления ребер в граф: строки концов новых ребер - по одному ребру,
+    // остальные строки - за один параллельный проход по всем ребрам, O(V^2) на ребро в худшем случае.
+    // Ребро, которое не короче уже известного маршрута между его концами, пропускается.
+    // Количество вершин графа меняться не должно
+    void AddEdges(const std::vector<EdgeId>& edge_ids);
+
+    // Таблицы весов и последних ребер маршрутов, по vertex_count * vertex_count элементов
+    [[nodiscard]] const Weight* GetWeights() const {
+        return weights_view_;
+    }
+    [[nodiscard]] const EdgeId* GetPrevEdges() const {
+        return prev_edges_view_;
+    }
+    [[nodiscard]] size_t GetTableSize() const {
+        return vertex_count_ * vertex_count_;
+    }
 
 private:
-    struct RouteInternalData {
-        Weight weight;
-        std::optional<EdgeId> prev_edge;
-    };
-    using RoutesInternalData = std::vector<std::vector<std::optional<RouteInternalData>>>;
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
 
     void InitializeRoutesInternalData(const Graph& graph) {
-        const size_t vertex_count = graph.GetVertexCount();
-        for (VertexId vertex = 0; vertex < vertex_count; ++vertex) {
-            routes_internal_data_[vertex][vertex] = RouteInternalData{ZERO_WEIGHT, std::nullopt};
-            for (const EdgeId edge_id : graph.GetIncidentEdges(vertex)) {
-                const auto& edge = graph.GetEdge(edge_id);
-                if (edge.weight < ZERO_WEIGHT) {
+        for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+            weights_[Index(vertex, vertex)] = ZERO_WEIGHT;
+            // Дуги, а не GetIncidentEdges: в графе могут быть неявные ребра линий
+            for (const auto& arc : graph.GetIncidentArcs(vertex)) {
+                if (arc.weight < ZERO_WEIGHT) {
                     throw std::domain_error("Edges' weights should be non-negative");
                 }
-                auto& route_internal_data = routes_internal_data_[vertex][edge.to];
-                if (!route_internal_data || route_internal_data->weight > edge.weight) {
-                    route_internal_data = RouteInternalData{edge.weight, edge_id};
+                const size_t index = Index(vertex, arc.vertex);
+                if (weights_[index] > arc.weight) {
+                    weights_[index] = arc.weight;
+                    prev_edges_[index] = arc.edge_id;
                 }
             }
         }
     }
 
-    void RelaxRoute(VertexId vertex_from, VertexId vertex_to, const RouteInternalData& route_from,
-                    const RouteInternalData& route_to) {
-        auto& route_relaxing = routes_internal_data_[vertex_from][vertex_to];
-        const Weight candidate_weight = route_from.weight + route_to.weight;
-        if (!route_relaxing || candidate_weight < route_relaxing->weight) {
-            route_relaxing = {candidate_weight,
-                              route_to.prev_edge ? route_to.prev_edge : route_from.prev_edge};
+    // Релаксирует строку from маршрутами, которые идут по ребру edge, а затем по строке edge.to.
+    // Строка edge.to через новое ребро не улучшается и не должна меняться одновременно
+    void RelaxThroughEdge(VertexId from, EdgeId edge_id, const Edge<Weight>& edge) {
+        const Weight weight_to_edge = weights_[Index(from, edge.from)];
+        if (weight_to_edge == INFINITE_WEIGHT) {
+            return;
+        }
+        const Weight weight_through = weight_to_edge + edge.weight;
+        Weight* row_from = weights_.data() + Index(from, 0);
+        EdgeId* prev_from = prev_edges_.data() + Index(from, 0);
+        // Если новое ребро не улучшает маршрут до edge.to, то не улучшит и маршруты дальше
+        if (!(weight_through < row_from[edge.to])) {
+            return;
         }
+        const Weight* row_to = weights_.data() + Index(edge.to, 0);
+        const EdgeId* prev_to = prev_edges_.data() + Index(edge.to, 0);
+        for (size_t to = 0; to < vertex_count_; ++to) {
+            if (row_to[to] == INFINITE_WEIGHT) {
+                continue;
+            }
+            const Weight candidate_weight = weight_through + row_to[to];
+            if (candidate_weight < row_from[to]) {
+                row_from[to] = candidate_weight;
+                prev_from[to] = to == edge.to ? edge_id : prev_to[to];
+            }
+        }
+    }
+
+    size_t Index(VertexId from, VertexId to) const {
+        return static_cast<size_t>(from) * vertex_count_ + to;
     }
 
-    void RelaxRoutesInternalDataThroughVertex(size_t vertex_count, VertexId vertex_through) {
-        for (VertexId vertex_from = 0; vertex_from < vertex_count; ++vertex_from) {
-            if (const auto& route_from = routes_internal_data_[vertex_from][vertex_through]) {
-                for (VertexId vertex_to = 0; vertex_to < vertex_count; ++vertex_to) {
-                    if (const auto& route_to = routes_internal_data_[vertex_through][vertex_to]) {
-                        RelaxRoute(vertex_from, vertex_to, *route_from, *route_to);
-                    }
+    // Релаксирует маршруты from -> [begin, end) через вершину through.
+    // Последнее ребро нового маршрута - последнее ребро маршрута through -> to:
+    // маршрут through -> through пустой, но через него путь не может стать строго короче.
+    void RelaxRow(VertexId from, VertexId through, size_t begin, size_t end) {
+        const Weight weight_through = weights_[Index(from, through)];
+        if (weight_through == INFINITE_WEIGHT) {
+            return;
+        }
+        const Weight* row_through = weights_.data() + Index(through, 0);
+        const EdgeId* prev_through = prev_edges_.data() + Index(through, 0);
+        Weight* row_from = weights_.data() + Index(from, 0);
+        EdgeId* prev_from = prev_edges_.data() + Index(from, 0);
+        // Для double бесконечность в сумме остается бесконечностью, и строку обрабатывает векторное ядро
+        if constexpr (std::is_same_v<Weight, double>) {
+            min_plus::RelaxRow(weight_through, row_through + begin, prev_through + begin,
+                               row_from + begin, prev_from + begin, end - begin);
+        } else {
+            for (size_t to = begin; to < end; ++to) {
+                if (row_through[to] == INFINITE_WEIGHT) {
+                    continue;
+                }
+                const Weight candidate_weight = weight_through + row_through[to];
+                if (candidate_weight < row_from[to]) {
+                    row_from[to] = candidate_weight;
+                    prev_from[to] = prev_through[to];
                 }
             }
         }
     }
 
+    // Релаксирует блок (block_from, block_to) через вершины блока block_through
+    void RelaxBlock(size_t block_from, size_t block_to, size_t block_through) {
+        const auto [from_begin, from_end] = BlockRange(block_from);
+        const auto [to_begin, to_end] = BlockRange(block_to);
+        const auto [through_begin, through_end] = BlockRange(block_through);
+        for (size_t through = through_begin; through < through_end; ++through) {
+            for (size_t from = from_begin; from < from_end; ++from) {
+                RelaxRow(static_cast<VertexId>(from), static_cast<VertexId>(through), to_begin, to_end);
+            }
+        }
+    }
+
+    std::pair<size_t, size_t> BlockRange(size_t block) const {
+        return {block * BLOCK_SIZE, std::min(vertex_count_, (block + 1) * BLOCK_SIZE)};
+    }
+
+    void RelaxRoutesInternalData() {
+        const size_t block_count = (vertex_count_ + BLOCK_SIZE - 1) / BLOCK_SIZE;
+        for (size_t block_through = 0; block_through < block_count; ++block_through) {
+            // Фаза 1: диагональный блок зависит только от себя
+            RelaxBlock(block_through, block_through, block_through);
+
+            // Фаза 2: блоки строки и столбца block_through зависят от диагонального блока
+            parallel::ParallelFor(0, 2 * block_count, [&](size_t task) {
+                const size_t block = task / 2;
+                if (block == block_through) {
+                    return;
+                }
+                if (task % 2 == 0) {
+                    RelaxBlock(block_through, block, block_through);
+                } else {
+                    RelaxBlock(block, block_through, block_through);
+                }
+            });
+
+            // Фаза 3: остальные блоки зависят только от блоков строки и столбца block_through
+            parallel::ParallelFor(0, block_count * block_count, [&](size_t task) {
+                const size_t block_from = task / block_count;
+                const size_t block_to = task % block_count;
+                if (block_from == block_through || block_to == block_through) {
+                    return;
+                }
+                RelaxBlock(block_from, block_to, block_through);
+            });
+        }
+    }
+
     static constexpr Weight ZERO_WEIGHT{};
+    static constexpr Weight INFINITE_WEIGHT = InfiniteWeight<Weight>();
     const Graph& graph_;
-    RoutesInternalData routes_internal_data_;
+    size_t vertex_count_;
+    std::vector<Weight> weights_;
+    std::vector<EdgeId> prev_edges_;
+    const Weight* weights_view_ = nullptr;
+    const EdgeId* prev_edges_view_ = nullptr;
 };
 
 template <typename Weight>
 Router<Weight>::Router(const Graph& graph)
     : graph_(graph)
-    , routes_internal_data_(graph.GetVertexCount(),
-                            std::vector<std::optional<RouteInternalData>>(graph.GetVertexCount()))
+    , vertex_count_(graph.GetVertexCount())
+    , weights_(vertex_count_ * vertex_count_, INFINITE_WEIGHT)
+    , prev_edges_(vertex_count_ * vertex_count_, NO_EDGE)
 {
     InitializeRoutesInternalData(graph);
+    RelaxRoutesInternalData();
+    weights_view_ = weights_.data();
+    prev_edges_view_ = prev_edges_.data();
+}
+
+template <typename Weight>
+Router<Weight>::Router(const Graph& graph, const Weight* weights, const EdgeId* prev_edges)
+    : graph_(graph)
+    , vertex_count_(graph.GetVertexCount())
+    , weights_view_(weights)
+    , prev_edges_view_(prev_edges)
+{
+}
 
-    const size_t vertex_count = graph.GetVertexCount();
-    for (VertexId vertex_through = 0; vertex_through < vertex_count; ++vertex_through) {
-        RelaxRoutesInternalDataThroughVertex(vertex_count, vertex_through);
+template <typename Weight>
+void Router<Weight>::AddEdges(const std::vector<EdgeId>& edge_ids) {
+    if (graph_.GetVertexCount() != vertex_count_) {
+        throw std::logic_error("Vertex count of the graph has changed");
     }
+    // Таблицы из файла доступны только для чтения, поэтому перед изменением копируются
+    if (weights_.empty() && vertex_count_ > 0) {
+        weights_.assign(weights_view_, weights_view_ + GetTableSize());
+        prev_edges_.assign(prev_edges_view_, prev_edges_view_ + GetTableSize());
+        weights_view_ = weights_.data();
+        prev_edges_view_ = prev_edges_.data();
+    }
+
+    // Ребро, которое не короче уже известного маршрута между его концами, не сократит ни один маршрут
+    std::vector<std::pair<EdgeId, Edge<Weight>>> edges;
+    std::vector<bool> is_head(vertex_count_, false);
+    for (const EdgeId edge_id : edge_ids) {
+        const auto edge = graph_.GetEdge(edge_id);
+        if (edge.weight < ZERO_WEIGHT) {
+            throw std::domain_error("Edges' weights should be non-negative");
+        }
+        if (edge.weight < weights_[Index(edge.from, edge.to)]) {
+            edges.emplace_back(edge_id, edge);
+            is_head[edge.to] = true;
+        }
+    }
+    if (edges.empty()) {
+        return;
+    }
+
+    // Строки концов новых ребер зависят только друг от друга: они обновляются по одному ребру,
+    // как при добавлении ребер по очереди, и после этого окончательны
+    std::vector<VertexId> heads;
+    for (VertexId vertex = 0; vertex < vertex_count_; ++vertex) {
+        if (is_head[vertex]) {
+            heads.push_back(vertex);
+        }
+    }
+    for (const auto& [edge_id, edge] : edges) {
+        for (const VertexId head : heads) {
+            RelaxThroughEdge(head, edge_id, edge);
+        }
+    }
+
+    // Первое новое ребро кратчайшего маршрута из остальных строк ведет в готовую строку его конца,
+    // поэтому каждую строку достаточно один раз релаксировать через все новые ребра
+    parallel::ParallelFor(0, vertex_count_, [&](size_t from) {
+        if (is_head[from]) {
+            return;
+        }
+        for (const auto& [edge_id, edge] : edges) {
+            RelaxThroughEdge(static_cast<VertexId>(from), edge_id, edge);
+        }
+    });
+}
+
+template <typename Weight>
+std::vector<Weight> Router<Weight>::BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                      const std::vector<VertexId>& targets) const {
+    std::vector<Weight> weights;
+    weights.reserve(sources.size() * targets.size());
+    for (const VertexId from : sources) {
+        for (const VertexId to : targets) {
+            if (from >= vertex_count_ || to >= vertex_count_) {
+                throw std::out_of_range("Vertex id is out of range");
+            }
+            weights.push_back(weights_view_[Index(from, to)]);
+        }
+    }
+    return weights;
 }
 
 template <typename Weight>
 std::optional<typename Router<Weight>::RouteInfo> Router<Weight>::BuildRoute(VertexId from,
                                                                              VertexId to) const {
-    const auto& route_internal_data = routes_internal_data_.at(from).at(to);
-    if (!route_internal_data) {
+    if (from >= vertex_count_ || to >= vertex_count_) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    const Weight weight = weights_view_[Index(from, to)];
+    if (weight == INFINITE_WEIGHT) {
         return std::nullopt;
     }
-    const Weight weight = route_internal_data->weight;
     std::vector<EdgeId> edges;
-    for (std::optional<EdgeId> edge_id = route_internal_data->prev_edge;
-         edge_id;
-         edge_id = routes_internal_data_[from][graph_.GetEdge(*edge_id).from]->prev_edge)
+    for (EdgeId edge_id = prev_edges_view_[Index(from, to)];
+         edge_id != NO_EDGE;
+         edge_id = prev_edges_view_[Index(from, graph_.GetEdge(edge_id).from)])
     {
-        edges.push_back(*edge_id);
+        edges.push_back(edge_id);
     }
     std::reverse(edges.begin(), edges.end());
 
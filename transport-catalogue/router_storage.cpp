@@ -0,0 +1,210 @@
+#include "router_storage.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace router_storage {
+
+    namespace {
+        constexpr char MAGIC[8] = {'T', 'C', 'R', 'O', 'U', 'T', 'E', '\0'};
+        constexpr uint32_t FORMAT_VERSION = 1;
+        constexpr size_t ALIGNMENT = 8;
+
+        struct FileHeader {
+            char magic[8];
+            uint32_t version;
+            uint32_t block_count;
+            uint64_t fingerprint;
+            uint64_t checksum;
+        };
+
+        size_t AlignedSize(size_t size) {
+            return (size + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+        }
+    }
+
+    MappedFile::MappedFile(const std::string &path) {
+        const int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Cannot open file " + path);
+        }
+        struct stat file_stat{};
+        if (fstat(fd, &file_stat) != 0 || file_stat.st_size == 0) {
+            close(fd);
+            throw std::runtime_error("Cannot read size of file " + path);
+        }
+        void *data = mmap(nullptr, static_cast<size_t>(file_stat.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+        // Отображение остается действительным и после закрытия дескриптора
+        close(fd);
+        if (data == MAP_FAILED) {
+            throw std::runtime_error("Cannot map file " + path);
+        }
+        data_ = static_cast<const char *>(data);
+        size_ = static_cast<size_t>(file_stat.st_size);
+    }
+
+    MappedFile::MappedFile(MappedFile &&other) noexcept
+            : data_(std::exchange(other.data_, nullptr)), size_(std::exchange(other.size_, 0)) {
+    }
+
+    MappedFile &MappedFile::operator=(MappedFile &&other) noexcept {
+        if (this != &other) {
+            Unmap();
+            data_ = std::exchange(other.data_, nullptr);
+            size_ = std::exchange(other.size_, 0);
+        }
+        return *this;
+    }
+
+    MappedFile::~MappedFile() {
+        Unmap();
+    }
+
+    void MappedFile::Unmap() noexcept {
+        if (data_ != nullptr) {
+            munmap(const_cast<char *>(data_), size_);
+            data_ = nullptr;
+            size_ = 0;
+        }
+    }
+
+    void Hasher::Add(const void *data, size_t size) noexcept {
+        const auto *bytes = static_cast<const unsigned char *>(data);
+        // Сначала дополняем слово, оставшееся неполным с прошлого вызова
+        while (size > 0 && pending_size_ > 0) {
+            pending_[pending_size_++] = *bytes++;
+            --size;
+            if (pending_size_ == sizeof(pending_)) {
+                uint64_t word = 0;
+                std::memcpy(&word, pending_, sizeof(word));
+                hash_ = Mix(hash_, word);
+                pending_size_ = 0;
+            }
+        }
+        for (; size >= sizeof(uint64_t); size -= sizeof(uint64_t), bytes += sizeof(uint64_t)) {
+            uint64_t word = 0;
+            std::memcpy(&word, bytes, sizeof(word));
+            hash_ = Mix(hash_, word);
+        }
+        for (; size > 0; --size) {
+            pending_[pending_size_++] = *bytes++;
+        }
+    }
+
+    uint64_t Hasher::Get() const noexcept {
+        if (pending_size_ == 0) {
+            return hash_;
+        }
+        uint64_t word = 0;
+        std::memcpy(&word, pending_, pending_size_);
+        return Mix(Mix(hash_, word), pending_size_);
+    }
+
+    uint64_t Hasher::Mix(uint64_t hash, uint64_t word) noexcept {
+        hash = (hash ^ word) * 1099511628211ULL;
+        return hash ^ (hash >> 32);
+    }
+
+    void SaveTables(const std::string &path, uint64_t fingerprint, const std::vector<Block> &blocks) {
+        static constexpr char PADDING[ALIGNMENT] = {};
+
+        // Контрольная сумма покрывает все после заголовка, включая выравнивание
+        Hasher checksum;
+        std::vector<uint64_t> block_sizes;
+        for (const Block &block: blocks) {
+            block_sizes.push_back(block.size);
+        }
+        checksum.Add(block_sizes.data(), block_sizes.size() * sizeof(uint64_t));
+        for (const Block &block: blocks) {
+            checksum.Add(block.data, block.size);
+            checksum.Add(PADDING, AlignedSize(block.size) - block.size);
+        }
+
+        FileHeader header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = FORMAT_VERSION;
+        header.block_count = static_cast<uint32_t>(blocks.size());
+        header.fingerprint = fingerprint;
+        header.checksum = checksum.Get();
+
+        const std::string temporary_path = path + ".tmp";
+        {
+            std::ofstream output(temporary_path, std::ios::binary | std::ios::trunc);
+            output.write(reinterpret_cast<const char *>(&header), sizeof(header));
+            output.write(reinterpret_cast<const char *>(block_sizes.data()),
+                         static_cast<std::streamsize>(block_sizes.size() * sizeof(uint64_t)));
+            for (const Block &block: blocks) {
+                output.write(static_cast<const char *>(block.data), static_cast<std::streamsize>(block.size));
+                output.write(PADDING, static_cast<std::streamsize>(AlignedSize(block.size) - block.size));
+            }
+            if (!output) {
+                std::remove(temporary_path.c_str());
+                throw std::runtime_error("Cannot write router tables to " + temporary_path);
+            }
+        }
+        if (std::rename(temporary_path.c_str(), path.c_str()) != 0) {
+            std::remove(temporary_path.c_str());
+            throw std::runtime_error("Cannot replace router tables file " + path);
+        }
+    }
+
+    std::optional<StoredTables> LoadTables(const std::string &path, uint64_t fingerprint,
+                                           const std::vector<size_t> &block_sizes, bool verify_checksum) {
+        std::optional<MappedFile> file;
+        try {
+            file.emplace(path);
+        } catch (const std::runtime_error &) {
+            return std::nullopt;
+        }
+
+        const size_t sizes_offset = sizeof(FileHeader);
+        size_t expected_size = sizes_offset + block_sizes.size() * sizeof(uint64_t);
+        for (const size_t size: block_sizes) {
+            expected_size += AlignedSize(size);
+        }
+        if (file->Size() != expected_size) {
+            return std::nullopt;
+        }
+
+        FileHeader header{};
+        std::memcpy(&header, file->Data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(MAGIC)) != 0
+            || header.version != FORMAT_VERSION
+            || header.block_count != block_sizes.size()
+            || header.fingerprint != fingerprint) {
+            return std::nullopt;
+        }
+        for (size_t i = 0; i < block_sizes.size(); ++i) {
+            uint64_t stored_size = 0;
+            std::memcpy(&stored_size, file->Data() + sizes_offset + i * sizeof(uint64_t), sizeof(stored_size));
+            if (stored_size != block_sizes[i]) {
+                return std::nullopt;
+            }
+        }
+
+        if (verify_checksum) {
+            Hasher checksum;
+            checksum.Add(file->Data() + sizes_offset, file->Size() - sizes_offset);
+            if (checksum.Get() != header.checksum) {
+                return std::nullopt;
+            }
+        }
+
+        StoredTables tables{std::move(*file), {}};
+        size_t offset = sizes_offset + block_sizes.size() * sizeof(uint64_t);
+        for (const size_t size: block_sizes) {
+            tables.blocks.push_back(tables.file.Data() + offset);
+            offset += AlignedSize(size);
+        }
+        return tables;
+    }
+
+}  // namespace router_storage
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+// Хранение предподсчитанных таблиц маршрутизатора в двоичном файле.
+// Файл состоит из заголовка (сигнатура, версия формата, отпечаток графа, контрольная сумма),
+// размеров блоков и самих блоков, выровненных по 8 байт. При следующем запуске файл отображается
+// в память и таблицы используются прямо из него: страницы подгружает ОС по мере обращения.
+namespace router_storage {
+
+    // Файл, отображенный в память только для чтения
+    class MappedFile final {
+    public:
+        // Бросает std::runtime_error, если файл не удалось открыть или отобразить
+        explicit MappedFile(const std::string &path);
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+        MappedFile(MappedFile &&other) noexcept;
+        MappedFile &operator=(MappedFile &&other) noexcept;
+
+        ~MappedFile();
+
+        [[nodiscard]] const char *Data() const noexcept {
+            return data_;
+        }
+        [[nodiscard]] size_t Size() const noexcept {
+            return size_;
+        }
+
+    private:
+        void Unmap() noexcept;
+
+        const char *data_ = nullptr;
+        size_t size_ = 0;
+    };
+
+    // Хеш в духе FNV-1a, который обрабатывает данные словами по 8 байт, для отпечатков и контрольных сумм.
+    // Результат не зависит от того, какими частями переданы данные
+    class Hasher final {
+    public:
+        void Add(const void *data, size_t size) noexcept;
+
+        template <typename T>
+        void AddValue(const T &value) noexcept {
+            Add(&value, sizeof(value));
+        }
+
+        [[nodiscard]] uint64_t Get() const noexcept;
+
+    private:
+        static uint64_t Mix(uint64_t hash, uint64_t word) noexcept;
+
+        uint64_t hash_ = 14695981039346656037ULL;
+        unsigned char pending_[8] = {};
+        size_t pending_size_ = 0;
+    };
+
+    struct Block {
+        const void *data;
+        size_t size;
+    };
+
+    // Загруженные таблицы: указатели на блоки действительны, пока жив file
+    struct StoredTables {
+        MappedFile file;
+        std::vector<const char *> blocks;
+    };
+
+    // Записывает блоки во временный файл и переименовывает его в path,
+    // чтобы параллельно запущенный процесс не прочитал недописанный файл
+    void SaveTables(const std::string &path, uint64_t fingerprint, const std::vector<Block> &blocks);
+
+    // nullopt, если файла нет или он не подходит: другая версия формата, отпечаток или размеры блоков.
+    // Проверяется только начало файла, блоки не читаются, и страницы таблиц подгружаются по первому обращению.
+    // С verify_checksum файл читается целиком и должна сойтись контрольная сумма
+    std::optional<StoredTables> LoadTables(const std::string &path, uint64_t fingerprint,
+                                           const std::vector<size_t> &block_sizes, bool verify_checksum = false);
+
+}  // namespace router_storage
@@ -0,0 +1,105 @@
+#pragma once
+
+#include "graph.h"
+#include "radix_heap.h"
+#include "router.h"
+
+#include <algorithm>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace graph {
+
+// Дерево кратчайших путей из одной вершины: веса до всех вершин и последнее ребро каждого пути
+template <typename Weight>
+struct ShortestPathTree {
+    static constexpr EdgeId NO_EDGE = std::numeric_limits<EdgeId>::max();
+
+    VertexId root;
+    std::vector<Weight> weights;
+    std::vector<EdgeId> prev_edges;
+
+    [[nodiscard]] bool IsReachable(VertexId vertex) const {
+        return weights.at(vertex) != InfiniteWeight<Weight>();
+    }
+
+    // Память, которую занимает дерево для графа с vertex_count вершинами
+    static size_t EstimateMemory(size_t vertex_count) {
+        return sizeof(ShortestPathTree) + vertex_count * (sizeof(Weight) + sizeof(EdgeId));
+    }
+};
+
+// Строит дерево кратчайших путей алгоритмом Дейкстры по замороженному графу.
+// Для беззнаковых целых весов очередь - RadixHeap.
+// Пути тяжелее max_weight не продолжаются, и вершины за этой границей остаются недостижимыми
+template <typename Weight>
+ShortestPathTree<Weight> BuildShortestPathTree(const DirectedWeightedGraph<Weight>& graph, VertexId root,
+                                               Weight max_weight = InfiniteWeight<Weight>()) {
+    static constexpr Weight ZERO_WEIGHT{};
+
+    if (root >= graph.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    ShortestPathTree<Weight> tree{root,
+                                  std::vector<Weight>(graph.GetVertexCount(), InfiniteWeight<Weight>()),
+                                  std::vector<EdgeId>(graph.GetVertexCount(), ShortestPathTree<Weight>::NO_EDGE)};
+    MinQueue<Weight, VertexId> queue;
+    tree.weights[root] = ZERO_WEIGHT;
+    queue.push({ZERO_WEIGHT, root});
+
+    while (!queue.empty()) {
+        const auto [weight, vertex] = queue.top();
+        queue.pop();
+        if (weight > tree.weights[vertex]) {
+            continue;
+        }
+        for (const auto& arc : graph.GetIncidentArcs(vertex)) {
+            const Weight candidate_weight = weight + arc.weight;
+            if (candidate_weight < tree.weights[arc.vertex] && candidate_weight <= max_weight) {
+                tree.weights[arc.vertex] = candidate_weight;
+                tree.prev_edges[arc.vertex] = arc.edge_id;
+                queue.push({candidate_weight, arc.vertex});
+            }
+        }
+    }
+    return tree;
+}
+
+// Восстанавливает маршрут до вершины to за O(длины маршрута)
+template <typename Weight>
+std::optional<typename BaseRouter<Weight>::RouteInfo> ExtractRoute(const ShortestPathTree<Weight>& tree,
+                                                                   const DirectedWeightedGraph<Weight>& graph,
+                                                                   VertexId to) {
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+    if (!tree.IsReachable(to)) {
+        return std::nullopt;
+    }
+    std::vector<EdgeId> edges;
+    for (EdgeId edge_id = tree.prev_edges[to];
+         edge_id != ShortestPathTree<Weight>::NO_EDGE;
+         edge_id = tree.prev_edges[graph.GetEdge(edge_id).from])
+    {
+        edges.push_back(edge_id);
+    }
+    std::reverse(edges.begin(), edges.end());
+    return RouteInfo{tree.weights[to], std::move(edges)};
+}
+
+// Маршруты из from во все вершины targets по одному дереву кратчайших путей
+template <typename Weight>
+std::vector<std::optional<typename BaseRouter<Weight>::RouteInfo>> BuildTreeRoutes(
+        const DirectedWeightedGraph<Weight>& graph, VertexId from, const std::vector<VertexId>& targets) {
+    const auto tree = BuildShortestPathTree(graph, from);
+    std::vector<std::optional<typename BaseRouter<Weight>::RouteInfo>> routes;
+    routes.reserve(targets.size());
+    for (const VertexId to : targets) {
+        routes.push_back(ExtractRoute(tree, graph, to));
+    }
+    return routes;
+}
+
+}  // namespace graph
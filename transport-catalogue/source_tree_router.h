@@ -0,0 +1,109 @@
+#pragma once
+
+#include "dijkstra_router.h"
+#include "graph.h"
+#include "parallel.h"
+#include "router.h"
+#include "shortest_path_tree.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <stdexcept>
+#include <vector>
+
+namespace graph {
+
+// Маршрутизатор для заранее известных начальных вершин: деревья кратчайших путей строятся
+// параллельно только из них, а не таблица для всех вершин графа. Маршрут из такой вершины
+// восстанавливается по дереву за O(длины маршрута), из любой другой - двунаправленным Дейкстрой.
+template <typename Weight>
+class SourceTreeRouter final : public BaseRouter<Weight> {
+private:
+    using Graph = DirectedWeightedGraph<Weight>;
+    using Tree = ShortestPathTree<Weight>;
+
+public:
+    using RouteInfo = typename BaseRouter<Weight>::RouteInfo;
+
+    // Повторы в sources допускаются, дерево строится один раз
+    SourceTreeRouter(const Graph& graph, std::vector<VertexId> sources);
+
+    std::optional<RouteInfo> BuildRoute(VertexId from, VertexId to) const override;
+
+    // Строки для начальных вершин с деревьями берутся из деревьев
+    std::vector<Weight> BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                          const std::vector<VertexId>& targets) const override;
+
+    [[nodiscard]] size_t GetTreeCount() const {
+        return trees_.size();
+    }
+
+private:
+    static constexpr uint32_t NO_TREE = std::numeric_limits<uint32_t>::max();
+
+    const Graph& graph_;
+    DijkstraRouter<Weight> fallback_;
+    std::vector<Tree> trees_;
+    // Номер дерева в trees_ для каждой вершины или NO_TREE
+    std::vector<uint32_t> tree_indices_;
+};
+
+template <typename Weight>
+SourceTreeRouter<Weight>::SourceTreeRouter(const Graph& graph, std::vector<VertexId> sources)
+    : graph_(graph)
+    , fallback_(graph)
+    , tree_indices_(graph.GetVertexCount(), NO_TREE)
+{
+    std::sort(sources.begin(), sources.end());
+    sources.erase(std::unique(sources.begin(), sources.end()), sources.end());
+    if (!sources.empty() && sources.back() >= graph.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+
+    trees_.resize(sources.size());
+    parallel::ParallelFor(0, sources.size(), [&](size_t index) {
+        trees_[index] = BuildShortestPathTree(graph_, sources[index]);
+    });
+    for (uint32_t index = 0; index < sources.size(); ++index) {
+        tree_indices_[sources[index]] = index;
+    }
+}
+
+template <typename Weight>
+std::optional<typename SourceTreeRouter<Weight>::RouteInfo> SourceTreeRouter<Weight>::BuildRoute(VertexId from,
+                                                                                                 VertexId to) const {
+    if (from >= graph_.GetVertexCount() || to >= graph_.GetVertexCount()) {
+        throw std::out_of_range("Vertex id is out of range");
+    }
+    if (tree_indices_[from] == NO_TREE) {
+        return fallback_.BuildRoute(from, to);
+    }
+    return ExtractRoute(trees_[tree_indices_[from]], graph_, to);
+}
+
+template <typename Weight>
+std::vector<Weight> SourceTreeRouter<Weight>::BuildWeightMatrix(const std::vector<VertexId>& sources,
+                                                                const std::vector<VertexId>& targets) const {
+    std::vector<Weight> result(sources.size() * targets.size(), InfiniteWeight<Weight>());
+    parallel::ParallelFor(0, sources.size(), [&](size_t row) {
+        const VertexId source = sources[row];
+        if (source >= graph_.GetVertexCount()) {
+            throw std::out_of_range("Vertex id is out of range");
+        }
+        Weight* row_weights = result.data() + row * targets.size();
+        if (tree_indices_[source] == NO_TREE) {
+            const std::vector<Weight> weights = fallback_.BuildWeightMatrix({source}, targets);
+            std::copy(weights.begin(), weights.end(), row_weights);
+            return;
+        }
+        const Tree& tree = trees_[tree_indices_[source]];
+        for (size_t column = 0; column < targets.size(); ++column) {
+            row_weights[column] = tree.weights.at(targets[column]);
+        }
+    });
+    return result;
+}
+
+}  // namespace graph
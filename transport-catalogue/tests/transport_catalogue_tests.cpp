@@ -0,0 +1,428 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "fixed_point.h"
+#include "graph.h"
+#include "router_storage.h"
+#include "transport_catalogue.h"
+#include "transport_router.h"
+
+namespace {
+
+    void Check(bool condition, const std::string &message) {
+        if (!condition) {
+            throw std::runtime_error(message);
+        }
+    }
+
+    // Маршрут в том виде, в каком его добавляет JsonReader: некольцевой - туда и обратно
+    std::vector<std::string_view> ExpandRoute(std::vector<std::string_view> stops, bool is_roundtrip) {
+        if (!is_roundtrip) {
+            stops.insert(stops.end(), std::next(stops.rbegin()), stops.rend());
+        } else if (stops.front() != stops.back()) {
+            stops.push_back(stops.front());
+        }
+        return stops;
+    }
+
+    // Повтор остановки подряд не добавляет расстояние S2 -> S2 к длине маршрута в статистике
+    void TestBusStatSkipsRepeatedStops() {
+        TransportCatalogue catalogue;
+        catalogue.AddStop("S2", {55.60, 37.20});
+        catalogue.AddStop("S3", {55.61, 37.21});
+        catalogue.AddDistance("S2", "S2", 3169);
+        catalogue.AddDistance("S2", "S3", 4535);
+        catalogue.AddDistance("S3", "S2", 4535);
+        catalogue.AddRoute("B", ExpandRoute({"S2", "S2", "S3"}, false), false);
+
+        const RouteInfo info = catalogue.BusRouteInfo("B");
+        Check(info.total_stops == 5, "stop_count: " + std::to_string(info.total_stops));
+        Check(info.unique_stops == 2, "unique_stop_count: " + std::to_string(info.unique_stops));
+        Check(info.length == 9070.0, "route_length: " + std::to_string(info.length));
+
+        // Расстояние, добавленное после маршрута, тоже учитывается
+        catalogue.AddDistance("S3", "S2", 5000);
+        Check(catalogue.BusRouteInfo("B").length == 9535.0, "route_length after AddDistance");
+    }
+
+    // Без расстояния по дорогам между соседними остановками статистика недоступна, как и раньше
+    void TestBusStatRequiresRoadDistances() {
+        TransportCatalogue catalogue;
+        catalogue.AddStop("A", {55.60, 37.20});
+        catalogue.AddStop("B", {55.61, 37.21});
+        catalogue.AddRoute("X", ExpandRoute({"A", "A", "B"}, false), false);
+        try {
+            (void) catalogue.BusRouteInfo("X");
+        } catch (const std::out_of_range &) {
+            return;
+        }
+        Check(false, "missing road distance should throw std::out_of_range");
+    }
+
+    // Загрузка проверяет только заголовок и размеры блоков, контрольная сумма блоков - по запросу
+    void TestRouterStorageChecksumIsOptional() {
+        const std::string path = "router_storage_test.bin";
+        const std::vector<uint64_t> table{1, 2, 3, 4};
+        const uint64_t fingerprint = 42;
+        const std::vector<size_t> block_sizes{table.size() * sizeof(uint64_t)};
+        router_storage::SaveTables(path, fingerprint, {{table.data(), block_sizes[0]}});
+
+        Check(router_storage::LoadTables(path, fingerprint, block_sizes, true).has_value(), "valid file rejected");
+        Check(!router_storage::LoadTables(path, fingerprint + 1, block_sizes).has_value(), "fingerprint ignored");
+
+        // Портим последний байт таблицы
+        {
+            std::fstream file(path, std::ios::binary | std::ios::in | std::ios::out);
+            file.seekp(-1, std::ios::end);
+            file.put('\x7f');
+        }
+        Check(router_storage::LoadTables(path, fingerprint, block_sizes).has_value(), "payload read without verify");
+        Check(!router_storage::LoadTables(path, fingerprint, block_sizes, true).has_value(), "checksum not verified");
+        std::remove(path.c_str());
+    }
+
+    // Граф с целыми весами сохраняет линии и номера ребер, а веса ребер линий отличаются
+    // от округленных не больше чем на единицу
+    void TestFixedPointGraphKeepsLines() {
+        graph::DirectedWeightedGraph<double> graph(6);
+        graph.AddEdge({0, 1, 0.5});
+        graph.AddLine({{1, 3, 5}, {0, 2, 4}, {0.0, 1234.0, 2345.0}, 666.7});
+        graph.AddEdge({2, 3, 1.25});
+        graph.AddLine({{5, 3}, {4, 2}, {0.0, 999.0}, 666.7});
+        graph.Freeze();
+        Check(!graph.HasNegativeWeights(), "non-negative graph reported negative");
+
+        const double scale = 60.0 * 1000.0;
+        const auto fixed_graph = graph::MakeFixedPointGraph<uint32_t>(graph, scale);
+        Check(fixed_graph.GetLineCount() == graph.GetLineCount(), "lines expanded into stored edges");
+        Check(fixed_graph.GetEdgeCount() == graph.GetEdgeCount(), "edge count differs");
+        for (graph::EdgeId edge_id = 0; edge_id < graph.GetEdgeCount(); ++edge_id) {
+            const auto edge = graph.GetEdge(edge_id);
+            const auto fixed_edge = fixed_graph.GetEdge(edge_id);
+            Check(edge.from == fixed_edge.from && edge.to == fixed_edge.to,
+                  "edge " + std::to_string(edge_id) + " has other vertices");
+            Check(std::abs(static_cast<double>(fixed_edge.weight) - std::round(edge.weight * scale)) <= 1.0,
+                  "edge " + std::to_string(edge_id) + " weight " + std::to_string(fixed_edge.weight));
+        }
+
+        graph::DirectedWeightedGraph<double> negative(4);
+        negative.AddLine({{1, 3}, {0, 2}, {10.0, 5.0}, 1.0});
+        negative.Freeze();
+        Check(negative.HasNegativeWeights(), "negative line weight not found");
+    }
+
+    // Сеть из шести остановок с разными расстояниями в разные стороны и двумя маршрутами
+    void FillUpdateCatalogue(TransportCatalogue &catalogue) {
+        const std::vector<std::string_view> stops{"S0", "S1", "S2", "S3", "S4", "S5"};
+        for (size_t i = 0; i < stops.size(); ++i) {
+            catalogue.AddStop(stops[i], {55.60 + 0.01 * static_cast<double>(i), 37.20 + 0.005 * static_cast<double>(i % 3)});
+        }
+        for (size_t i = 0; i < stops.size(); ++i) {
+            for (size_t j = 0; j < stops.size(); ++j) {
+                if (i != j) {
+                    catalogue.AddDistance(stops[i], stops[j], 1000 + 300 * ((i * 7 + j * 3) % 5));
+                }
+            }
+        }
+        catalogue.AddRoute("1", ExpandRoute({"S0", "S1", "S2", "S3"}, false), false);
+        catalogue.AddRoute("2", ExpandRoute({"S3", "S4", "S5", "S3"}, true), true);
+    }
+
+    TransportRouter MakeRouter(const TransportCatalogue &catalogue, RoutingStrategy strategy, bool implicit) {
+        return TransportRouterBuilder(catalogue)
+                .SetBusWaitTime(6)
+                .SetBusVelocity(40)
+                .SetRoutingStrategy(strategy)
+                .SetImplicitBusEdges(implicit)
+                .Build();
+    }
+
+    // Маршрут найден у обоих или ни у одного, и время в пути совпадает. Этапы не сравниваются:
+    // при равном времени алгоритмы выбирают разные маршруты
+    void CheckSameTime(const std::optional<Itinerary> &expected, const std::optional<Itinerary> &actual,
+                       const std::string &context) {
+        Check(expected.has_value() == actual.has_value(), context + ": reachability differs");
+        if (expected) {
+            Check(std::abs(expected->total_time - actual->total_time) < 1e-9,
+                  context + ": " + std::to_string(actual->total_time) + " instead of "
+                  + std::to_string(expected->total_time));
+        }
+    }
+
+    // Время маршрутов между всеми парами остановок совпадает у обновленного и заново построенного маршрутизатора
+    void CheckSameItineraries(const TransportCatalogue &catalogue, const TransportRouter &updated,
+                              RoutingStrategy strategy, bool implicit, const std::string &context) {
+        const TransportRouter rebuilt = MakeRouter(catalogue, strategy, implicit);
+        for (const auto &[from, from_stop]: catalogue.GetAllSortedStops()) {
+            for (const auto &[to, to_stop]: catalogue.GetAllSortedStops()) {
+                CheckSameTime(rebuilt.FindItinerary(from, to), updated.FindItinerary(from, to),
+                              context + " " + std::string(from) + " -> " + std::string(to));
+            }
+        }
+    }
+
+    // Более короткая дорога и новый автобус добавляются в построенный маршрутизатор без перестройки,
+    // более длинная дорога перестраивает его. Ответы совпадают с маршрутизатором, построенным заново
+    void TestIncrementalUpdateMatchesRebuild() {
+        const std::vector<RoutingStrategy> strategies{
+                RoutingStrategy::AllPairs, RoutingStrategy::CompactAllPairs, RoutingStrategy::Dijkstra,
+                RoutingStrategy::AStar, RoutingStrategy::CachedTrees, RoutingStrategy::ContractionHierarchies,
+                RoutingStrategy::HubLabels, RoutingStrategy::Raptor, RoutingStrategy::SourceTrees,
+        };
+        for (const RoutingStrategy strategy: strategies) {
+            for (const bool implicit: {false, true}) {
+                const std::string context = "strategy " + std::to_string(static_cast<int>(strategy))
+                                            + (implicit ? " implicit" : " explicit");
+                TransportCatalogue catalogue;
+                FillUpdateCatalogue(catalogue);
+                TransportRouter router = MakeRouter(catalogue, strategy, implicit);
+                // Заполняем кэши до обновления
+                CheckSameItineraries(catalogue, router, strategy, implicit, context + " initial");
+
+                catalogue.AddDistance("S1", "S2", 200);
+                router.UpdateDistances(catalogue);
+                CheckSameItineraries(catalogue, router, strategy, implicit, context + " shorter road");
+
+                catalogue.AddRoute("3", ExpandRoute({"S0", "S2", "S4"}, false), false);
+                router.AddBus(catalogue, "3");
+                CheckSameItineraries(catalogue, router, strategy, implicit, context + " new bus");
+
+                catalogue.AddDistance("S2", "S4", 3000);
+                router.UpdateDistances(catalogue);
+                CheckSameItineraries(catalogue, router, strategy, implicit, context + " longer road");
+            }
+        }
+    }
+
+    // Сеть для сравнения с Флойдом-Уоршеллом: кольцевые и некольцевые маршруты, повторы остановок подряд,
+    // расстояния только в одну сторону, отдельная компонента и остановки без автобусов.
+    // seed == 0 - небольшая сеть, заданная вручную, иначе - случайная
+    void FillMixedCatalogue(TransportCatalogue &catalogue, uint32_t seed) {
+        uint32_t state = seed;
+        const auto random = [&state](uint32_t bound) {
+            state = state * 1103515245u + 12345u;
+            return (state >> 16) % bound;
+        };
+        const size_t stops_count = seed == 0 ? 10 : 30;
+        std::vector<std::string> names;
+        for (size_t i = 0; i < stops_count; ++i) {
+            names.push_back("S" + std::to_string(i));
+            catalogue.AddStop(names.back(), {55.60 + 0.003 * static_cast<double>(i % 7),
+                                             37.20 + 0.004 * static_cast<double>(i / 7)});
+        }
+
+        std::vector<std::pair<std::vector<std::string_view>, bool>> routes;
+        if (seed == 0) {
+            routes = {
+                    {{"S0", "S1", "S2", "S3", "S0"}, true},
+                    {{"S2", "S4", "S4", "S5"}, false},
+                    {{"S5", "S1", "S6"}, true},
+                    {{"S7", "S8"}, false},
+            };
+        } else {
+            // Последние две остановки остаются без автобусов
+            for (size_t bus = 0; bus < 8; ++bus) {
+                std::vector<std::string_view> stops;
+                const size_t length = 2 + random(6);
+                for (size_t i = 0; i < length; ++i) {
+                    stops.push_back(names[random(static_cast<uint32_t>(stops_count - 2))]);
+                    if (random(6) == 0) {
+                        stops.push_back(stops.back());
+                    }
+                }
+                routes.emplace_back(std::move(stops), random(2) == 0);
+            }
+        }
+
+        for (const auto &[stops, is_roundtrip]: routes) {
+            for (size_t i = 0; i + 1 < stops.size(); ++i) {
+                const uint32_t variant = seed == 0 ? static_cast<uint32_t>(i % 3) : random(3);
+                catalogue.AddDistance(stops[i], stops[i + 1], 400 + 100 * (seed == 0 ? i * 7 % 11 : random(30)));
+                // Иначе обратно едут по расстоянию в прямую сторону
+                if (variant == 0) {
+                    catalogue.AddDistance(stops[i + 1], stops[i], 500 + 100 * (seed == 0 ? i * 5 % 13 : random(30)));
+                }
+            }
+        }
+        for (size_t bus = 0; bus < routes.size(); ++bus) {
+            const auto &[stops, is_roundtrip] = routes[bus];
+            catalogue.AddRoute("B" + std::to_string(bus), ExpandRoute(stops, is_roundtrip), is_roundtrip);
+        }
+    }
+
+    // Время в пути совпадает, nullopt - маршрута нет
+    void CheckSameTime(std::optional<double> expected, std::optional<double> actual, const std::string &context) {
+        Check(expected.has_value() == actual.has_value(), context + ": reachability differs");
+        if (expected) {
+            Check(std::abs(*expected - *actual) < 1e-9,
+                  context + ": " + std::to_string(*actual) + " instead of " + std::to_string(*expected));
+        }
+    }
+
+    // Остановки, достижимые за max_time, совпадают вместе со временем. Порядок при равном времени не важен
+    void CheckSameReachableStops(const std::vector<ReachableStop> &expected, const std::vector<ReachableStop> &actual,
+                                 const std::string &context) {
+        std::map<std::string_view, double> expected_times;
+        for (const ReachableStop &stop: expected) {
+            expected_times[stop.name] = stop.time;
+        }
+        std::map<std::string_view, double> actual_times;
+        for (const ReachableStop &stop: actual) {
+            actual_times[stop.name] = stop.time;
+        }
+        Check(expected_times.size() == actual_times.size(), context + ": reachable stop count differs");
+        for (const auto &[name, time]: expected_times) {
+            const auto it = actual_times.find(name);
+            CheckSameTime(time, it == actual_times.end() ? std::nullopt : std::optional(it->second),
+                          context + " " + std::string(name));
+        }
+    }
+
+    // Маршруты между всеми парами остановок, по одному и пачкой, матрица времени и остановки,
+    // достижимые из каждой за полчаса, совпадают по времени с RoutingStrategy::AllPairs
+    void CheckMatchesAllPairs(const TransportCatalogue &catalogue, RoutingStrategy strategy,
+                              const std::string &context) {
+        const TransportRouter expected = MakeRouter(catalogue, RoutingStrategy::AllPairs, false);
+        const TransportRouter actual = MakeRouter(catalogue, strategy, false);
+        std::vector<TransportRouter::RouteRequest> requests;
+        std::vector<std::optional<Itinerary>> expected_itineraries;
+        size_t unreachable = 0;
+        for (const auto &[from, from_stop]: catalogue.GetAllSortedStops()) {
+            for (const auto &[to, to_stop]: catalogue.GetAllSortedStops()) {
+                requests.push_back({from, to});
+                expected_itineraries.push_back(expected.FindItinerary(from, to));
+                unreachable += expected_itineraries.back() ? 0 : 1;
+                CheckSameTime(expected_itineraries.back(), actual.FindItinerary(from, to),
+                              context + " " + std::string(from) + " -> " + std::string(to));
+            }
+        }
+        Check(unreachable > 0, context + ": the network should have unreachable pairs");
+
+        const auto batch = actual.FindItineraries(requests);
+        for (size_t index = 0; index < requests.size(); ++index) {
+            CheckSameTime(expected_itineraries[index], batch[index],
+                          context + " batch " + std::string(requests[index].stop_from) + " -> "
+                          + std::string(requests[index].stop_to));
+        }
+
+        std::vector<std::string_view> stops;
+        for (const auto &[name, stop]: catalogue.GetAllSortedStops()) {
+            stops.push_back(name);
+        }
+        const auto expected_matrix = expected.FindTimeMatrix(stops);
+        const auto actual_matrix = actual.FindTimeMatrix(stops);
+        for (size_t row = 0; row < stops.size(); ++row) {
+            for (size_t column = 0; column < stops.size(); ++column) {
+                CheckSameTime(expected_matrix[row][column], actual_matrix[row][column],
+                              context + " matrix " + std::string(stops[row]) + " -> " + std::string(stops[column]));
+            }
+            CheckSameReachableStops(expected.FindReachableStops(stops[row], 30.0),
+                                    actual.FindReachableStops(stops[row], 30.0),
+                                    context + " isochrone " + std::string(stops[row]));
+        }
+    }
+
+    // Точные алгоритмы отвечают так же, как таблица Флойда-Уоршелла
+    void TestStrategiesMatchAllPairs() {
+        const std::vector<std::pair<RoutingStrategy, std::string>> strategies{
+                {RoutingStrategy::ContractionHierarchies, "contraction_hierarchies"},
+                {RoutingStrategy::Raptor, "raptor"},
+                {RoutingStrategy::CompactAllPairs, "compact_all_pairs"},
+                {RoutingStrategy::AStar, "astar"},
+                {RoutingStrategy::HubLabels, "hub_labels"},
+        };
+        for (const uint32_t seed: {0u, 1u, 2u, 3u}) {
+            TransportCatalogue catalogue;
+            FillMixedCatalogue(catalogue, seed);
+            for (const auto &[strategy, name]: strategies) {
+                CheckMatchesAllPairs(catalogue, strategy, name + " seed " + std::to_string(seed));
+            }
+        }
+    }
+
+    // Ограничение пересадок в Raptor: быстрый маршрут с двумя пересадками недоступен при max_transfers = 1,
+    // и вместо него выбирается медленный автобус без пересадок
+    void TestRaptorMaxTransfers() {
+        TransportCatalogue catalogue;
+        catalogue.AddStop("A", {55.60, 37.20});
+        catalogue.AddStop("B", {55.61, 37.20});
+        catalogue.AddStop("C", {55.62, 37.20});
+        catalogue.AddStop("D", {55.63, 37.20});
+        catalogue.AddDistance("A", "B", 1000);
+        catalogue.AddDistance("B", "C", 1000);
+        catalogue.AddDistance("C", "D", 1000);
+        catalogue.AddDistance("A", "D", 20000);
+        catalogue.AddRoute("F1", ExpandRoute({"A", "B"}, false), false);
+        catalogue.AddRoute("F2", ExpandRoute({"B", "C"}, false), false);
+        catalogue.AddRoute("F3", ExpandRoute({"C", "D"}, false), false);
+        catalogue.AddRoute("Slow", ExpandRoute({"A", "D"}, false), false);
+
+        const auto make_router = [&catalogue](size_t max_transfers) {
+            return TransportRouterBuilder(catalogue)
+                    .SetBusWaitTime(6)
+                    .SetBusVelocity(40)
+                    .SetRoutingStrategy(RoutingStrategy::Raptor)
+                    .SetMaxTransfers(max_transfers)
+                    .Build();
+        };
+        // Каждый быстрый автобус - 6 минут ожидания и 1.5 минуты в пути, медленный - 6 и 30
+        const TransportRouter unlimited = make_router(RaptorRouter::UNLIMITED_TRANSFERS);
+        const TransportRouter two_transfers = make_router(2);
+        const TransportRouter one_transfer = make_router(1);
+
+        CheckSameTime(unlimited.FindItinerary("A", "D")->total_time, 22.5, "unlimited");
+        CheckSameTime(two_transfers.FindItinerary("A", "D")->total_time, 22.5, "two transfers");
+        const auto itinerary = one_transfer.FindItinerary("A", "D");
+        CheckSameTime(itinerary->total_time, 36.0, "one transfer");
+        Check(itinerary->items.size() == 2 && itinerary->items[1].name == "Slow", "one transfer: slow bus expected");
+        CheckSameTime(one_transfer.FindItineraries({{"A", "D"}})[0]->total_time, 36.0, "one transfer batch");
+        CheckSameTime(one_transfer.FindTimeMatrix({"A", "D"})[0][1], 36.0, "one transfer matrix");
+        CheckSameTime(unlimited.FindTimeMatrix({"A", "D"})[0][1], 22.5, "unlimited matrix");
+
+        // За полчаса D достижима только с пересадками
+        const auto reaches_d = [](const std::vector<ReachableStop> &stops) {
+            return std::any_of(stops.begin(), stops.end(), [](const ReachableStop &stop) {
+                return stop.name == "D";
+            });
+        };
+        Check(reaches_d(unlimited.FindReachableStops("A", 30.0)), "unlimited isochrone should reach D");
+        Check(!reaches_d(one_transfer.FindReachableStops("A", 30.0)), "one transfer isochrone should not reach D");
+    }
+
+}  // namespace
+
+int main() {
+    const std::vector<std::pair<std::string_view, void (*)()>> tests{
+            {"TestBusStatSkipsRepeatedStops", TestBusStatSkipsRepeatedStops},
+            {"TestBusStatRequiresRoadDistances", TestBusStatRequiresRoadDistances},
+            {"TestRouterStorageChecksumIsOptional", TestRouterStorageChecksumIsOptional},
+            {"TestIncrementalUpdateMatchesRebuild", TestIncrementalUpdateMatchesRebuild},
+            {"TestFixedPointGraphKeepsLines", TestFixedPointGraphKeepsLines},
+            {"TestStrategiesMatchAllPairs", TestStrategiesMatchAllPairs},
+            {"TestRaptorMaxTransfers", TestRaptorMaxTransfers},
+    };
+    int failed = 0;
+    for (const auto &[name, test]: tests) {
+        try {
+            test();
+            std::cerr << name << " OK" << std::endl;
+        } catch (const std::exception &e) {
+            std::cerr << name << " FAILED: " << e.what() << std::endl;
+            ++failed;
+        }
+    }
+    return failed == 0 ? 0 : 1;
+}
@@ -22,23 +22,60 @@ void TransportCatalogue::AddRoute(string_view bus_name, const vector<string_view
         AssociateStopWithBus(stopname_to_stop_[stopname], new_bus);
         bus_routes_[new_bus->name_]->route_.push_back(stopname_to_stop_[stopname]);
     }
+    IndexRouteDistances(new_bus);
+}
+
+void TransportCatalogue::IndexRouteDistances(const Bus *bus) {
+    const auto &route = bus->route_;
+    RouteDistances &distances = route_distances_[bus];
+    distances.forward.assign(route.size(), 0);
+    distances.backward.assign(route.size(), 0);
+    distances.route_length = 0;
+    for (size_t i = 1; i < route.size(); ++i) {
+        distances.forward[i] = distances.forward[i - 1] + Distance(route[i - 1], route[i]);
+        distances.backward[i] = distances.backward[i - 1] + Distance(route[i], route[i - 1]);
+
+        // Для статистики стоянка на той же остановке не считается поездкой
+        if (route[i] == route[i - 1] || !distances.route_length.has_value()) {
+            continue;
+        }
+        const auto distance = FindDistance(route[i - 1], route[i]);
+        distances.route_length = distance.has_value() ? std::optional(*distances.route_length + *distance)
+                                                      : std::nullopt;
+    }
+}
+
+size_t TransportCatalogue::RouteDistance(const Bus *bus, size_t from_position, size_t to_position) const {
+    const RouteDistances &distances = route_distances_.at(bus);
+    if (from_position <= to_position) {
+        return distances.forward.at(to_position) - distances.forward.at(from_position);
+    }
+    return distances.backward.at(from_position) - distances.backward.at(to_position);
 }
 
 Bus TransportCatalogue::FindRoute(string_view bus_name) const {
     return *bus_routes_.at(bus_name);
 }
 
+const Bus *TransportCatalogue::FindBus(string_view bus_name) const {
+    return bus_routes_.at(bus_name);
+}
+
 size_t TransportCatalogue::Distance(const Stop *from, const Stop *to) const {
     if (from == nullptr || to == nullptr) {
         throw std::invalid_argument("Cannot calculate distanses between null pointer stop(s)");
     }
-    if (stop_to_near_stop_.count({from, to})) {
-        return stop_to_near_stop_.at({from, to});
+    return FindDistance(from, to).value_or(0);
+}
+
+std::optional<size_t> TransportCatalogue::FindDistance(const Stop *from, const Stop *to) const {
+    if (const auto it = stop_to_near_stop_.find({from, to}); it != stop_to_near_stop_.end()) {
+        return it->second;
     }
-    if (stop_to_near_stop_.count({to, from})) {
-        return stop_to_near_stop_.at({to, from});
+    if (const auto it = stop_to_near_stop_.find({to, from}); it != stop_to_near_stop_.end()) {
+        return it->second;
     }
-    return 0;
+    return std::nullopt;
 }
 
 const Stop &TransportCatalogue::FindStop(string_view stop_name) const {
@@ -47,7 +84,7 @@ const Stop &TransportCatalogue::FindStop(string_view stop_name) const {
 
 RouteInfo TransportCatalogue::BusRouteInfo(string_view bus_name) const {
     double native_length = CalculateNativeRouteLength(string(bus_name));
-    double real_length = CalculateRealRouteLength(string(bus_name));
+    double real_length = CalculateRealRouteLength(bus_name);
     return {
             bus_routes_.at(string(bus_name))->route_.size(),
             CountUniqueRouteStops(string(bus_name)),
@@ -57,24 +94,11 @@ RouteInfo TransportCatalogue::BusRouteInfo(string_view bus_name) const {
 }
 
 double TransportCatalogue::CalculateRealRouteLength(std::string_view bus_name) const {
-    double route_length = 0;
-    const auto &route = bus_routes_.at(bus_name)->route_;
-    const Stop *last_stop = route.front();
-    for (const auto stop: route) {
-        if (stop == last_stop) {
-            continue;
-        }
-        try {
-            route_length += static_cast<double>(stop_to_near_stop_.at(
-                    make_pair(const_cast<Stop *>(last_stop), const_cast<Stop *>(stop))));
-        } catch (std::out_of_range &) {
-            route_length += static_cast<double>(stop_to_near_stop_.at(
-                    make_pair(const_cast<Stop *>(stop), const_cast<Stop *>(last_stop))));
-        }
-
-        last_stop = stop;
+    const auto &route_length = route_distances_.at(bus_routes_.at(bus_name)).route_length;
+    if (!route_length.has_value()) {
+        throw std::out_of_range("Road distance between route stops is unknown");
     }
-    return route_length;
+    return static_cast<double>(*route_length);
 }
 
 double TransportCatalogue::CalculateNativeRouteLength(string_view bus_name) const {
@@ -133,8 +157,18 @@ std::map<std::string_view, const Stop *> TransportCatalogue::GetAllSortedStops()
 }
 
 void TransportCatalogue::AddDistance(std::string_view stopname_from, std::string_view stopname_to, size_t distance) {
-    stop_to_near_stop_[{
-            stopname_to_stop_.at(stopname_from),
-            stopname_to_stop_.at(stopname_to)
-    }] = distance;
+    Stop *stop_from = stopname_to_stop_.at(stopname_from);
+    Stop *stop_to = stopname_to_stop_.at(stopname_to);
+    stop_to_near_stop_[{stop_from, stop_to}] = distance;
+
+    // Расстояние, добавленное после маршрутов, меняет накопленные расстояния проходящих через остановки автобусов
+    for (Stop *stop: {stop_from, stop_to}) {
+        const auto it = stop_to_buses_.find(stop);
+        if (it == stop_to_buses_.end()) {
+            continue;
+        }
+        for (std::string_view bus_name: it->second) {
+            IndexRouteDistances(bus_routes_.at(bus_name));
+        }
+    }
 }
@@ -7,6 +7,7 @@
 // STL
 #include <deque>
 #include <map>
+#include <optional>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -31,6 +32,16 @@ class TransportCatalogue final {
     using SortedBuses = std::set<std::string_view>;
     using StopsPair = std::pair<const Stop*, const Stop*>;
 
+    // Накопленные расстояния по дорогам от начала маршрута: forward - при движении по маршруту,
+    // backward - при движении по тем же остановкам в обратную сторону
+    // route_length - длина маршрута для статистики автобуса: повтор той же остановки подряд пропускается,
+    // nullopt - для какой-то пары соседних остановок расстояние по дорогам не задано
+    struct RouteDistances {
+        std::vector<size_t> forward;
+        std::vector<size_t> backward;
+        std::optional<size_t> route_length;
+    };
+
 public:
     void AddStop(std::string_view name, geo::Coordinates position);
 
@@ -42,8 +53,15 @@ public:
 
     [[maybe_unused]] [[nodiscard]] Bus FindRoute(std::string_view bus_name) const;
 
+    [[nodiscard]] const Bus* FindBus(std::string_view bus_name) const;
+
+    // Расстояние по дорогам в любую сторону, 0 - если не задано
     [[nodiscard]] size_t Distance(const Stop* from, const Stop* to) const;
 
+    // Расстояние по дорогам между позициями маршрута за O(1).
+    // Если from_position > to_position, автобус едет по остановкам маршрута в обратном порядке.
+    [[nodiscard]] size_t RouteDistance(const Bus* bus, size_t from_position, size_t to_position) const;
+
     [[nodiscard]] RouteInfo BusRouteInfo(std::string_view bus_name) const;
 
     [[nodiscard]] SortedBuses StopInfo(std::string_view stop_name) const;
@@ -55,6 +73,10 @@ public:
 private:
     void AssociateStopWithBus(Stop* stop, const Bus* bus);
 
+    void IndexRouteDistances(const Bus* bus);
+
+    [[nodiscard]] std::optional<size_t> FindDistance(const Stop* from, const Stop* to) const;
+
     [[nodiscard]] double CalculateRealRouteLength(std::string_view bus_name) const;
 
     [[nodiscard]] double CalculateNativeRouteLength(std::string_view bus_name) const;
@@ -67,4 +89,5 @@ private:
     std::deque<Bus> buses_;
     std::unordered_map<Stop*, Buses> stop_to_buses_;
     std::unordered_map<StopsPair, size_t, PairStopHasher> stop_to_near_stop_;
+    std::unordered_map<const Bus*, RouteDistances> route_distances_;
 };
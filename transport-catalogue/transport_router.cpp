@@ -1,20 +1,442 @@
 #include "transport_router.h"
 
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <map>
 #include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
+
+#include "parallel.h"
+
+namespace {
+    // Сторона решетки для кривой Гильберта: 2^16 клеток по каждой координате
+    constexpr uint32_t HILBERT_GRID_SIZE = 1u << 16;
+
+    // Номер клетки (x, y) вдоль кривой Гильберта, обходящей решетку HILBERT_GRID_SIZE x HILBERT_GRID_SIZE
+    uint64_t HilbertIndex(uint32_t x, uint32_t y) {
+        uint64_t index = 0;
+        for (uint32_t side = HILBERT_GRID_SIZE / 2; side > 0; side /= 2) {
+            const uint32_t rx = (x & side) > 0 ? 1 : 0;
+            const uint32_t ry = (y & side) > 0 ? 1 : 0;
+            index += static_cast<uint64_t>(side) * side * ((3 * rx) ^ ry);
+            // Поворачиваем четверть, чтобы кривая внутри нее шла в том же направлении
+            if (ry == 0) {
+                if (rx == 1) {
+                    x = HILBERT_GRID_SIZE - 1 - x;
+                    y = HILBERT_GRID_SIZE - 1 - y;
+                }
+                std::swap(x, y);
+            }
+        }
+        return index;
+    }
+}
+
+std::string_view RoutingStrategyName(RoutingStrategy strategy) {
+    switch (strategy) {
+        case RoutingStrategy::AllPairs:
+            return "all_pairs";
+        case RoutingStrategy::CompactAllPairs:
+            return "compact_all_pairs";
+        case RoutingStrategy::Dijkstra:
+            return "dijkstra";
+        case RoutingStrategy::AStar:
+            return "astar";
+        case RoutingStrategy::CachedTrees:
+            return "cached_trees";
+        case RoutingStrategy::ContractionHierarchies:
+            return "contraction_hierarchies";
+        case RoutingStrategy::HubLabels:
+            return "hub_labels";
+        case RoutingStrategy::Raptor:
+            return "raptor";
+        case RoutingStrategy::SourceTrees:
+            return "source_trees";
+    }
+    return "unknown";
+}
 
 TransportRouter::TransportRouter(
         const TransportRouterSettings &settings,
         const TransportCatalogue &catalogue
         ) : settings_(settings) {
+    Initialize(catalogue);
+}
+
+void TransportRouter::Initialize(const TransportCatalogue &catalogue) {
+    if (settings_.strategy == RoutingStrategy::Raptor) {
+        raptor_ = std::make_unique<RaptorRouter>(catalogue, settings_.bus_wait_time, settings_.bus_velocity);
+        return;
+    }
 
     graph::DirectedWeightedGraph<double> stops_graph(catalogue.GetAllSortedStops().size() * 2);
     graph::VertexId vertex_id = 0;
 
     FillGraphStops(catalogue, vertex_id, stops_graph);
     FillGraphBuses(catalogue, vertex_id, stops_graph);
+    stops_graph.Freeze();
 
     graph_ = std::move(stops_graph);
-    router_ = std::make_unique<graph::Router<double>>(graph_);
+    BuildRouter(catalogue);
+}
+
+void TransportRouter::BuildRouter(const TransportCatalogue &catalogue) {
+    // Старый маршрутизатор может ссылаться на отображенный файл таблиц, который заменит новый
+    router_.reset();
+    tree_cache_ = nullptr;
+    switch (settings_.strategy) {
+        case RoutingStrategy::AllPairs:
+            if (UsesFixedPointWeights()) {
+                router_ = std::make_unique<graph::FixedPointRouter<double, FixedWeight>>(
+                        graph_, FIXED_POINT_SCALE, [this](const graph::DirectedWeightedGraph<FixedWeight> &graph) {
+                            return MakeAllPairsRouter(graph);
+                        });
+            } else {
+                router_ = MakeAllPairsRouter(graph_);
+            }
+            break;
+        case RoutingStrategy::CompactAllPairs:
+            router_ = MakeCompactRouter();
+            break;
+        case RoutingStrategy::Dijkstra:
+            if (UsesFixedPointWeights()) {
+                router_ = std::make_unique<graph::FixedPointRouter<double, FixedWeight>>(
+                        graph_, FIXED_POINT_SCALE, [](const graph::DirectedWeightedGraph<FixedWeight> &graph) {
+                            return std::make_unique<graph::DijkstraRouter<FixedWeight>>(graph);
+                        });
+            } else {
+                router_ = std::make_unique<graph::DijkstraRouter<double>>(graph_);
+            }
+            break;
+        case RoutingStrategy::AStar:
+            router_ = MakeAStarRouter(catalogue);
+            break;
+        case RoutingStrategy::CachedTrees: {
+            auto tree_cache = std::make_unique<graph::CachedTreeRouter<double>>(
+                    graph_, settings_.tree_cache_memory_limit);
+            tree_cache_ = tree_cache.get();
+            router_ = std::move(tree_cache);
+            break;
+        }
+        case RoutingStrategy::ContractionHierarchies:
+            router_ = std::make_unique<graph::ContractionHierarchyRouter<double>>(graph_);
+            break;
+        case RoutingStrategy::HubLabels:
+            router_ = std::make_unique<graph::HubLabelRouter<double>>(graph_);
+            break;
+        case RoutingStrategy::SourceTrees: {
+            // Неизвестные остановки пропускаются: запрос из них и так завершится ошибкой
+            std::vector<graph::VertexId> sources;
+            sources.reserve(settings_.route_origins.size());
+            for (const std::string &stop: settings_.route_origins) {
+                if (const auto it = stop_ids_.find(stop); it != stop_ids_.end()) {
+                    sources.push_back(it->second);
+                }
+            }
+            router_ = std::make_unique<graph::SourceTreeRouter<double>>(graph_, std::move(sources));
+            break;
+        }
+        case RoutingStrategy::Raptor:
+            break;
+    }
+}
+
+void TransportRouter::AddBus(const TransportCatalogue &catalogue, std::string_view bus_name) {
+    if (raptor_) {
+        raptor_ = std::make_unique<RaptorRouter>(catalogue, settings_.bus_wait_time, settings_.bus_velocity);
+        return;
+    }
+
+    const Bus *bus = catalogue.FindBus(bus_name);
+    for (const Stop *stop: bus->route_) {
+        if (stop_ids_.count(stop->name_) == 0) {
+            throw std::invalid_argument("Stop " + stop->name_ + " is unknown to the router");
+        }
+    }
+    names_.push_back(bus->name_);
+    const auto name_id = static_cast<uint32_t>(names_.size() - 1);
+    UpdateRouter(catalogue, AddBusEdges(catalogue, bus, name_id));
+}
+
+void TransportRouter::UpdateDistances(const TransportCatalogue &catalogue) {
+    if (raptor_) {
+        raptor_ = std::make_unique<RaptorRouter>(catalogue, settings_.bus_wait_time, settings_.bus_velocity);
+        return;
+    }
+
+    // Автобусы просматриваются по названию, чтобы номера новых ребер не зависели от порядка в хеш-таблице
+    std::vector<std::pair<const Bus *, uint32_t>> shortened;
+    for (const auto &[bus_name, bus]: catalogue.GetAllSortedBuses()) {
+        const auto it = bus_distances_.find(bus);
+        if (it == bus_distances_.end()) {
+            continue;
+        }
+        const std::vector<size_t> segments = RouteSegments(catalogue, bus);
+        const std::vector<size_t> &old_segments = it->second.segments;
+        if (segments == old_segments) {
+            continue;
+        }
+        // Веса ребер в графе не уменьшить и не удалить, поэтому более длинная дорога требует нового графа
+        for (size_t index = 0; index < segments.size(); ++index) {
+            if (segments[index] > old_segments[index]) {
+                Rebuild(catalogue);
+                return;
+            }
+        }
+        shortened.emplace_back(bus, it->second.name_id);
+    }
+
+    // Старые ребра автобусов остаются, но новые короче, и маршруты проходят по ним
+    std::vector<graph::EdgeId> edge_ids;
+    for (const auto &[bus, name_id]: shortened) {
+        const std::vector<graph::EdgeId> bus_edge_ids = AddBusEdges(catalogue, bus, name_id);
+        edge_ids.insert(edge_ids.end(), bus_edge_ids.begin(), bus_edge_ids.end());
+    }
+    if (!edge_ids.empty()) {
+        UpdateRouter(catalogue, edge_ids);
+    }
+}
+
+void TransportRouter::Rebuild(const TransportCatalogue &catalogue) {
+    // Маршрутизаторы ссылаются на граф и файл таблиц, поэтому удаляются первыми
+    router_.reset();
+    tree_cache_ = nullptr;
+    raptor_.reset();
+    stored_tables_.reset();
+    graph_ = {};
+    names_.clear();
+    edge_descriptions_.clear();
+    line_name_ids_.clear();
+    bus_distances_.clear();
+    stop_ids_.clear();
+    Initialize(catalogue);
+}
+
+std::vector<graph::EdgeId> TransportRouter::AddBusEdges(
+        const TransportCatalogue &catalogue,
+        const Bus *bus,
+        uint32_t name_id
+        ) {
+    bus_distances_[bus] = {name_id, RouteSegments(catalogue, bus)};
+
+    std::vector<graph::EdgeId> edge_ids;
+    if (settings_.implicit_bus_edges) {
+        // Номера ребер новых линий идут подряд после всех имеющихся
+        const auto first_edge = static_cast<graph::EdgeId>(graph_.GetEdgeCount());
+        graph_.Unfreeze();
+        AddBusLines(catalogue, bus, name_id, graph_);
+        graph_.Freeze();
+        edge_ids.resize(graph_.GetEdgeCount() - first_edge);
+        std::iota(edge_ids.begin(), edge_ids.end(), first_edge);
+        return edge_ids;
+    }
+
+    const BusEdges batch = PruneDominatedEdges(MakeBusEdges(catalogue, bus, name_id));
+
+    // Ребра, не лучшие уже имеющихся между теми же вершинами, не добавляются.
+    // Старые ребра, которые стали хуже новых, остаются: их удаление сдвинуло бы номера ребер
+    BusEdges added;
+    for (size_t index = 0; index < batch.edges.size(); ++index) {
+        if (!IsDominated(batch.edges[index], batch.descriptions[index])) {
+            added.edges.push_back(batch.edges[index]);
+            added.descriptions.push_back(batch.descriptions[index]);
+        }
+    }
+
+    edge_ids.reserve(added.edges.size());
+    graph_.Unfreeze();
+    for (const auto &edge: added.edges) {
+        edge_ids.push_back(graph_.AddEdge(edge));
+    }
+    graph_.Freeze();
+    edge_descriptions_.insert(edge_descriptions_.end(), added.descriptions.begin(), added.descriptions.end());
+    return edge_ids;
+}
+
+void TransportRouter::UpdateRouter(const TransportCatalogue &catalogue, const std::vector<graph::EdgeId> &edge_ids) {
+    switch (settings_.strategy) {
+        case RoutingStrategy::AllPairs:
+            // Копия графа с целыми весами строится заново вместе с таблицей
+            if (UsesFixedPointWeights()) {
+                BuildRouter(catalogue);
+                break;
+            }
+            // Таблицы из файла копируются при первом изменении, и отображение больше не нужно
+            static_cast<graph::Router<double> &>(*router_).AddEdges(edge_ids);
+            stored_tables_.reset();
+            break;
+        case RoutingStrategy::CachedTrees:
+            tree_cache_->AddEdges(edge_ids);
+            break;
+        case RoutingStrategy::Dijkstra:
+            if (UsesFixedPointWeights()) {
+                BuildRouter(catalogue);
+            }
+            break;
+        case RoutingStrategy::CompactAllPairs:
+        case RoutingStrategy::AStar:
+        case RoutingStrategy::ContractionHierarchies:
+        case RoutingStrategy::HubLabels:
+        case RoutingStrategy::SourceTrees:
+            BuildRouter(catalogue);
+            break;
+        case RoutingStrategy::Raptor:
+            break;
+    }
+}
+
+std::vector<size_t> TransportRouter::RouteSegments(const TransportCatalogue &catalogue, const Bus *bus) {
+    const size_t stops_count = bus->route_.size();
+    std::vector<size_t> segments;
+    segments.reserve(stops_count < 2 ? 0 : 2 * (stops_count - 1));
+    for (size_t i = 0; i + 1 < stops_count; ++i) {
+        segments.push_back(catalogue.RouteDistance(bus, i, i + 1));
+    }
+    for (size_t i = 0; i + 1 < stops_count; ++i) {
+        segments.push_back(catalogue.RouteDistance(bus, i + 1, i));
+    }
+    return segments;
+}
+
+bool TransportRouter::UsesFixedPointWeights() const {
+    return settings_.fixed_point_weights
+           && (settings_.strategy == RoutingStrategy::AllPairs || settings_.strategy == RoutingStrategy::Dijkstra);
+}
+
+template <typename Weight>
+std::unique_ptr<graph::BaseRouter<Weight>> TransportRouter::MakeAllPairsRouter(
+        const graph::DirectedWeightedGraph<Weight> &graph
+        ) {
+    if (settings_.router_cache_path.empty()) {
+        return std::make_unique<graph::Router<Weight>>(graph);
+    }
+
+    const size_t table_size = graph.GetVertexCount() * graph.GetVertexCount();
+    const std::vector<size_t> block_sizes{table_size * sizeof(Weight), table_size * sizeof(graph::EdgeId)};
+    const uint64_t fingerprint = GraphFingerprint({});
+    stored_tables_ = router_storage::LoadTables(settings_.router_cache_path, fingerprint, block_sizes,
+                                                settings_.verify_router_cache);
+    if (stored_tables_) {
+        return std::make_unique<graph::Router<Weight>>(
+                graph,
+                reinterpret_cast<const Weight *>(stored_tables_->blocks[0]),
+                reinterpret_cast<const graph::EdgeId *>(stored_tables_->blocks[1]));
+    }
+
+    auto router = std::make_unique<graph::Router<Weight>>(graph);
+    SaveRouterTables(fingerprint, {{router->GetWeights(), block_sizes[0]}, {router->GetPrevEdges(), block_sizes[1]}});
+    return router;
+}
+
+std::unique_ptr<graph::BaseRouter<double>> TransportRouter::MakeCompactRouter() {
+    using CompactRouter = graph::CompactRouter<double>;
+
+    std::vector<graph::VertexId> stop_vertices;
+    stop_vertices.reserve(stop_ids_.size());
+    for (const auto &[stop_name, stop_vertex]: stop_ids_) {
+        stop_vertices.push_back(stop_vertex);
+    }
+    // Строки таблицы идут в порядке вершин, а не названий
+    std::sort(stop_vertices.begin(), stop_vertices.end());
+    if (settings_.router_cache_path.empty()) {
+        return std::make_unique<CompactRouter>(graph_, stop_vertices);
+    }
+
+    const std::vector<size_t> block_sizes{stop_vertices.size() * stop_vertices.size() * sizeof(CompactRouter::Cell)};
+    const uint64_t fingerprint = GraphFingerprint(stop_vertices);
+    stored_tables_ = router_storage::LoadTables(settings_.router_cache_path, fingerprint, block_sizes,
+                                                settings_.verify_router_cache);
+    if (stored_tables_) {
+        return std::make_unique<CompactRouter>(
+                graph_, stop_vertices, reinterpret_cast<const CompactRouter::Cell *>(stored_tables_->blocks[0]));
+    }
+
+    auto router = std::make_unique<CompactRouter>(graph_, stop_vertices);
+    SaveRouterTables(fingerprint, {{router->GetTable(), block_sizes[0]}});
+    return router;
+}
+
+std::unique_ptr<graph::BaseRouter<double>> TransportRouter::MakeAStarRouter(const TransportCatalogue &catalogue) const {
+    // Небольшой запас, чтобы погрешность вычисления расстояний не сделала оценку недопустимой
+    static constexpr double SPEED_SAFETY_FACTOR = 1.001;
+
+    GeoLowerBound lower_bound{std::vector<geo::Coordinates>(graph_.GetVertexCount()), 0.0};
+    for (const auto &[stop_name, stop_vertex]: stop_ids_) {
+        const geo::Coordinates position = catalogue.FindStop(stop_name).position_;
+        lower_bound.coordinates[stop_vertex] = position;
+        lower_bound.coordinates[stop_vertex + 1] = position;
+    }
+    const auto add_edge_speed = [&lower_bound](graph::VertexId from, graph::VertexId to, double weight) {
+        const double distance = geo::ComputeDistance(lower_bound.coordinates[from], lower_bound.coordinates[to]);
+        if (std::isnan(distance) || distance == 0.0) {
+            return;
+        }
+        lower_bound.max_speed = std::max(lower_bound.max_speed, distance / weight);
+    };
+    for (const auto &edge: graph_.GetStoredEdges()) {
+        add_edge_speed(edge.from, edge.to, edge.weight);
+    }
+    // Ребро линии через несколько остановок не быстрее самого быстрого из пролетов между соседними:
+    // время по пролетам складывается, а расстояние по прямой не больше суммы расстояний
+    for (uint32_t line_index = 0; line_index < graph_.GetLineCount(); ++line_index) {
+        const auto &line = graph_.GetLine(line_index);
+        for (size_t position = 0; position + 1 < line.departures.size(); ++position) {
+            add_edge_speed(line.departures[position], line.arrivals[position + 1],
+                           (line.offsets[position + 1] - line.offsets[position]) / line.divisor);
+        }
+    }
+    lower_bound.max_speed *= SPEED_SAFETY_FACTOR;
+
+    return std::make_unique<graph::AStarRouter<double, GeoLowerBound>>(graph_, std::move(lower_bound));
+}
+
+double TransportRouter::GeoLowerBound::operator()(graph::VertexId from, graph::VertexId to) const {
+    // Без оценки скорости (например, ребро нулевого веса между разными точками) A* становится Дейкстрой
+    if (max_speed == 0.0 || std::isinf(max_speed)) {
+        return 0.0;
+    }
+    // Для очень близких точек acos может получить аргумент чуть больше 1
+    const double distance = geo::ComputeDistance(coordinates[from], coordinates[to]);
+    return std::isnan(distance) ? 0.0 : distance / max_speed;
+}
+
+uint64_t TransportRouter::GraphFingerprint(const std::vector<graph::VertexId> &terminals) const {
+    // Веса ребер уже учитывают расстояния, время ожидания и скорость автобусов
+    router_storage::Hasher hasher;
+    hasher.AddValue(static_cast<uint32_t>(settings_.strategy));
+    hasher.AddValue(UsesFixedPointWeights());
+    hasher.AddValue(static_cast<uint64_t>(graph_.GetVertexCount()));
+    hasher.AddValue(static_cast<uint64_t>(graph_.GetEdgeCount()));
+    for (const auto &edge: graph_.GetStoredEdges()) {
+        hasher.AddValue(edge.from);
+        hasher.AddValue(edge.to);
+        hasher.AddValue(edge.weight);
+    }
+    // Ребра линии задаются ее позициями и смещениями
+    for (uint32_t line_index = 0; line_index < graph_.GetLineCount(); ++line_index) {
+        const auto &line = graph_.GetLine(line_index);
+        hasher.AddValue(graph_.GetLineFirstEdge(line_index));
+        hasher.AddValue(static_cast<uint64_t>(line.departures.size()));
+        hasher.Add(line.departures.data(), line.departures.size() * sizeof(graph::VertexId));
+        hasher.Add(line.arrivals.data(), line.arrivals.size() * sizeof(graph::VertexId));
+        hasher.Add(line.offsets.data(), line.offsets.size() * sizeof(double));
+        hasher.AddValue(line.divisor);
+    }
+    hasher.Add(terminals.data(), terminals.size() * sizeof(graph::VertexId));
+    return hasher.Get();
+}
+
+void TransportRouter::SaveRouterTables(uint64_t fingerprint, const std::vector<router_storage::Block> &blocks) const {
+    try {
+        router_storage::SaveTables(settings_.router_cache_path, fingerprint, blocks);
+    } catch (const std::runtime_error &) {
+        // Файл только ускоряет следующий запуск, поэтому без него можно продолжить работу
+    }
 }
 
 std::optional<TransportRouter::RouteInfo>
@@ -22,11 +444,158 @@ TransportRouter::FindRoute(
         std::string_view stop_from,
         std::string_view stop_to
         ) const {
+    if (!router_) {
+        throw std::logic_error("Graph routes are not available for the selected routing strategy");
+    }
     return router_->BuildRoute(stop_ids_.at(std::string(stop_from)), stop_ids_.at(std::string(stop_to)));
 }
 
-TransportRouter::Graph TransportRouter::GetGraph() const {
-    return graph_;
+std::optional<Itinerary> TransportRouter::FindItinerary(
+        std::string_view stop_from,
+        std::string_view stop_to
+        ) const {
+    if (raptor_) {
+        return raptor_->FindRoute(stop_from, stop_to, settings_.max_transfers);
+    }
+
+    const auto route = FindRoute(stop_from, stop_to);
+    if (!route.has_value()) {
+        return std::nullopt;
+    }
+    return MakeItinerary(route->edges);
+}
+
+std::vector<std::optional<Itinerary>> TransportRouter::FindItineraries(const std::vector<RouteRequest> &requests) const {
+    std::vector<std::optional<Itinerary>> result(requests.size());
+    if (raptor_) {
+        parallel::ParallelFor(0, requests.size(), [&](size_t index) {
+            result[index] = raptor_->FindRoute(requests[index].stop_from, requests[index].stop_to,
+                                               settings_.max_transfers);
+        });
+        return result;
+    }
+    if (!router_) {
+        throw std::logic_error("Graph routes are not available for the selected routing strategy");
+    }
+
+    // Вершины ищутся заранее, чтобы неизвестная остановка вызвала исключение в вызывающем потоке
+    std::vector<graph::VertexId> targets(requests.size());
+    std::map<graph::VertexId, std::vector<size_t>> origins;
+    for (size_t index = 0; index < requests.size(); ++index) {
+        targets[index] = stop_ids_.at(std::string(requests[index].stop_to));
+        origins[stop_ids_.at(std::string(requests[index].stop_from))].push_back(index);
+    }
+    std::vector<std::pair<graph::VertexId, std::vector<size_t>>> groups(origins.begin(), origins.end());
+
+    // Дейкстра и A* строят одно дерево на группу, в том числе по графу с целыми весами,
+    // а таблицы и кэш деревьев и так отвечают без повторного поиска. Иерархии сжатия тоже отвечают
+    // запросами: каждый просматривает несколько сотен вершин, что дешевле полного Дейкстры из начала,
+    // и при равном времени выбирает тот же маршрут, что и FindItinerary
+    parallel::ParallelFor(0, groups.size(), [&](size_t group_index) {
+        const auto &[from, indices] = groups[group_index];
+        std::vector<graph::VertexId> group_targets;
+        group_targets.reserve(indices.size());
+        for (const size_t index: indices) {
+            group_targets.push_back(targets[index]);
+        }
+        const auto routes = router_->BuildRoutes(from, group_targets);
+        for (size_t position = 0; position < indices.size(); ++position) {
+            if (routes[position]) {
+                result[indices[position]] = MakeItinerary(routes[position]->edges);
+            }
+        }
+    });
+    return result;
+}
+
+std::vector<std::vector<std::optional<double>>> TransportRouter::FindTimeMatrix(
+        const std::vector<std::string_view> &stops
+        ) const {
+    std::vector<std::vector<std::optional<double>>> result(stops.size());
+    const auto fill_row = [&result](size_t row, const double *begin, const double *end) {
+        result[row].reserve(end - begin);
+        for (const double *time = begin; time != end; ++time) {
+            result[row].push_back(*time == graph::InfiniteWeight<double>() ? std::nullopt : std::optional(*time));
+        }
+    };
+
+    if (raptor_) {
+        parallel::ParallelFor(0, stops.size(), [&](size_t row) {
+            const std::vector<double> times = raptor_->FindTimes(stops[row], stops, settings_.max_transfers);
+            fill_row(row, times.data(), times.data() + times.size());
+        });
+        return result;
+    }
+    if (!router_) {
+        throw std::logic_error("Graph routes are not available for the selected routing strategy");
+    }
+
+    std::vector<graph::VertexId> vertices;
+    vertices.reserve(stops.size());
+    for (const std::string_view stop: stops) {
+        vertices.push_back(stop_ids_.at(std::string(stop)));
+    }
+    const std::vector<double> weights = router_->BuildWeightMatrix(vertices, vertices);
+    for (size_t row = 0; row < stops.size(); ++row) {
+        const double *row_begin = weights.data() + row * stops.size();
+        fill_row(row, row_begin, row_begin + stops.size());
+    }
+    return result;
+}
+
+std::vector<ReachableStop> TransportRouter::FindReachableStops(std::string_view stop_from, double max_time) const {
+    if (raptor_) {
+        return raptor_->FindReachableStops(stop_from, max_time, settings_.max_transfers);
+    }
+
+    const auto tree = graph::BuildShortestPathTree(graph_, stop_ids_.at(std::string(stop_from)), max_time);
+    std::vector<ReachableStop> reachable;
+    for (const auto &[stop_name, vertex]: stop_ids_) {
+        if (tree.IsReachable(vertex)) {
+            reachable.push_back({stop_name, tree.weights[vertex]});
+        }
+    }
+    // stop_ids_ упорядочен по названию, поэтому при равном времени порядок - по названию
+    std::stable_sort(reachable.begin(), reachable.end(), [](const ReachableStop &lhs, const ReachableStop &rhs) {
+        return lhs.time < rhs.time;
+    });
+    return reachable;
+}
+
+Itinerary TransportRouter::MakeItinerary(const std::vector<graph::EdgeId> &edges) const {
+    Itinerary itinerary{0.0, {}};
+    itinerary.items.reserve(edges.size());
+    for (const graph::EdgeId edge_id: edges) {
+        const auto edge = graph_.GetEdge(edge_id);
+        const EdgeDescription description = DescribeEdge(edge_id);
+        itinerary.items.push_back({
+                names_[description.name_id],
+                edge.weight,
+                description.span_count,
+                description.span_count == 0 ? RouteItem::Type::Wait : RouteItem::Type::Bus
+        });
+        itinerary.total_time += edge.weight;
+    }
+    return itinerary;
+}
+
+TransportRouter::EdgeInfo TransportRouter::GetEdgeInfo(graph::EdgeId edge_id) const {
+    const EdgeDescription description = DescribeEdge(edge_id);
+    return {names_[description.name_id], description.span_count};
+}
+
+TransportRouter::EdgeDescription TransportRouter::DescribeEdge(graph::EdgeId edge_id) const {
+    if (const auto line_edge = graph_.GetLineEdge(edge_id)) {
+        return {line_name_ids_[line_edge->line], line_edge->to_position - line_edge->from_position};
+    }
+    return edge_descriptions_.at(edge_id);
+}
+
+std::optional<TransportRouter::TreeCacheStats> TransportRouter::GetTreeCacheStats() const {
+    if (tree_cache_ == nullptr) {
+        return std::nullopt;
+    }
+    return tree_cache_->GetStats();
 }
 
 void TransportRouter::FillGraphStops(
@@ -34,52 +603,301 @@ void TransportRouter::FillGraphStops(
         graph::VertexId &vertex_id,
         graph::DirectedWeightedGraph<double> &stops_graph
         ) {
-    for (const auto &[stop_name, stop_info]: catalogue.GetAllSortedStops()) {
+    for (const Stop *stop_info: OrderStopsByLocality(catalogue)) {
         stop_ids_[stop_info->name_] = vertex_id;
+        names_.push_back(stop_info->name_);
         stops_graph.AddEdge({
-                stop_info->name_,
-                0,
                 vertex_id,
                 ++vertex_id,
                 static_cast<double>(settings_.bus_wait_time)
         });
+        edge_descriptions_.push_back({static_cast<uint32_t>(names_.size() - 1), 0});
         ++vertex_id;
     }
 }
 
+std::vector<const Stop *> TransportRouter::OrderStopsByLocality(const TransportCatalogue &catalogue) {
+    std::vector<const Stop *> stops;
+    for (const auto &[stop_name, stop_info]: catalogue.GetAllSortedStops()) {
+        stops.push_back(stop_info);
+    }
+    if (stops.empty()) {
+        return stops;
+    }
+
+    geo::Coordinates min = stops.front()->position_;
+    geo::Coordinates max = min;
+    for (const Stop *stop: stops) {
+        min = {std::min(min.lat, stop->position_.lat), std::min(min.lng, stop->position_.lng)};
+        max = {std::max(max.lat, stop->position_.lat), std::max(max.lng, stop->position_.lng)};
+    }
+    const auto to_grid = [](double value, double min_value, double max_value) {
+        if (!(max_value > min_value)) {
+            return uint32_t{0};
+        }
+        return static_cast<uint32_t>((value - min_value) / (max_value - min_value) * (HILBERT_GRID_SIZE - 1));
+    };
+
+    std::vector<std::pair<uint64_t, const Stop *>> keyed_stops;
+    keyed_stops.reserve(stops.size());
+    for (const Stop *stop: stops) {
+        keyed_stops.emplace_back(HilbertIndex(to_grid(stop->position_.lng, min.lng, max.lng),
+                                              to_grid(stop->position_.lat, min.lat, max.lat)),
+                                 stop);
+    }
+    std::stable_sort(keyed_stops.begin(), keyed_stops.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.first < rhs.first;
+    });
+    for (size_t index = 0; index < stops.size(); ++index) {
+        stops[index] = keyed_stops[index].second;
+    }
+    return stops;
+}
+
 void TransportRouter::FillGraphBuses(
         const TransportCatalogue &catalogue,
         graph::VertexId &vertex_id,
         graph::DirectedWeightedGraph<double> &stops_graph
         ) {
+    std::vector<const Bus *> buses;
     for (const auto &[bus_name, bus_info]: catalogue.GetAllSortedBuses()) {
-        const auto &stops = bus_info->route_;
-        size_t stops_count = stops.size();
-        for (size_t i = 0; i < stops_count; ++i) {
-            for (size_t j = i + 1; j < stops_count; ++j) {
-                const Stop *stop_from = stops[i];
-                const Stop *stop_to = stops[j];
-                size_t dist_sum = 0;
-                size_t dist_sum_inverse = 0;
-                for (size_t k = i + 1; k <= j; ++k) {
-                    dist_sum += catalogue.Distance(stops[k - 1], stops[k]);
-                    dist_sum_inverse += catalogue.Distance(stops[k], stops[k - 1]);
-                }
-                stops_graph.AddEdge({bus_info->name_,
-                                     j - i,
-                                     stop_ids_.at(stop_from->name_) + 1,
-                                     stop_ids_.at(stop_to->name_),
-                                     static_cast<double>(dist_sum) / (settings_.bus_velocity * (100.0 / 6.0))});
-
-                if (!bus_info->is_roundtrip_) {
-                    stops_graph.AddEdge({bus_info->name_,
-                                         j - i,
-                                         stop_ids_.at(stop_to->name_) + 1,
-                                         stop_ids_.at(stop_from->name_),
-                                         static_cast<double>(dist_sum_inverse) / (
-                                             settings_.bus_velocity * (100.0 / 6.0))});
-                }
+        buses.push_back(bus_info);
+    }
+    const auto first_name_id = static_cast<uint32_t>(names_.size());
+    for (const Bus *bus: buses) {
+        names_.push_back(bus->name_);
+        bus_distances_[bus] = {static_cast<uint32_t>(names_.size() - 1), RouteSegments(catalogue, bus)};
+    }
+    if (settings_.implicit_bus_edges) {
+        for (size_t index = 0; index < buses.size(); ++index) {
+            AddBusLines(catalogue, buses[index], first_name_id + static_cast<uint32_t>(index), stops_graph);
+        }
+        return;
+    }
+
+    // Ребра автобусов строятся независимо друг от друга, а номера в графе получают после сортировки
+    // в PruneDominatedEdges, поэтому номера ребер не зависят от числа потоков
+    std::vector<BusEdges> batches(buses.size());
+    parallel::ParallelFor(0, buses.size(), [&](size_t index) {
+        batches[index] = MakeBusEdges(catalogue, buses[index], first_name_id + static_cast<uint32_t>(index));
+    });
+
+    BusEdges merged;
+    size_t edge_count = 0;
+    for (const BusEdges &batch: batches) {
+        edge_count += batch.edges.size();
+    }
+    merged.edges.reserve(edge_count);
+    merged.descriptions.reserve(edge_count);
+    for (BusEdges &batch: batches) {
+        merged.edges.insert(merged.edges.end(), batch.edges.begin(), batch.edges.end());
+        merged.descriptions.insert(merged.descriptions.end(), batch.descriptions.begin(), batch.descriptions.end());
+        batch = {};
+    }
+    const BusEdges pruned = PruneDominatedEdges(std::move(merged));
+
+    stops_graph.ReserveEdges(stops_graph.GetEdgeCount() + pruned.edges.size());
+    edge_descriptions_.reserve(edge_descriptions_.size() + pruned.descriptions.size());
+    for (const auto &edge: pruned.edges) {
+        stops_graph.AddEdge(edge);
+    }
+    edge_descriptions_.insert(edge_descriptions_.end(), pruned.descriptions.begin(), pruned.descriptions.end());
+}
+
+TransportRouter::BusEdges TransportRouter::PruneDominatedEdges(BusEdges bus_edges) const {
+    std::vector<size_t> order(bus_edges.edges.size());
+    std::iota(order.begin(), order.end(), size_t{0});
+    const auto key = [&](size_t index) {
+        const auto &edge = bus_edges.edges[index];
+        const EdgeDescription &description = bus_edges.descriptions[index];
+        return std::tuple(edge.from, edge.to, edge.weight, names_[description.name_id], description.span_count);
+    };
+    std::sort(order.begin(), order.end(), [&](size_t lhs, size_t rhs) {
+        return key(lhs) < key(rhs);
+    });
+
+    BusEdges result;
+    for (const size_t index: order) {
+        const auto &edge = bus_edges.edges[index];
+        if (!result.edges.empty() && result.edges.back().from == edge.from && result.edges.back().to == edge.to) {
+            continue;
+        }
+        result.edges.push_back(edge);
+        result.descriptions.push_back(bus_edges.descriptions[index]);
+    }
+    return result;
+}
+
+bool TransportRouter::IsDominated(const graph::Edge<double> &edge, const EdgeDescription &description) const {
+    for (const auto &arc: graph_.GetIncidentArcs(edge.from)) {
+        if (arc.vertex != edge.to) {
+            continue;
+        }
+        const EdgeDescription existing = DescribeEdge(arc.edge_id);
+        if (std::tuple(arc.weight, names_[existing.name_id], existing.span_count)
+            <= std::tuple(edge.weight, names_[description.name_id], description.span_count)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+TransportRouter::BusEdges TransportRouter::MakeBusEdges(
+        const TransportCatalogue &catalogue,
+        const Bus *bus,
+        uint32_t name_id
+        ) const {
+    const auto &stops = bus->route_;
+    const size_t stops_count = stops.size();
+    std::vector<graph::VertexId> stop_vertices(stops_count);
+    for (size_t i = 0; i < stops_count; ++i) {
+        stop_vertices[i] = stop_ids_.at(stops[i]->name_);
+    }
+
+    BusEdges result;
+    const size_t pairs_count = stops_count < 2 ? 0 : stops_count * (stops_count - 1) / 2;
+    const size_t edges_count = bus->is_roundtrip_ ? pairs_count : pairs_count * 2;
+    result.edges.reserve(edges_count);
+    result.descriptions.reserve(edges_count);
+
+    const double meters_per_minute = settings_.bus_velocity * (100.0 / 6.0);
+    for (size_t i = 0; i < stops_count; ++i) {
+        for (size_t j = i + 1; j < stops_count; ++j) {
+            const auto span_count = static_cast<uint32_t>(j - i);
+            result.edges.push_back({stop_vertices[i] + 1,
+                                    stop_vertices[j],
+                                    static_cast<double>(catalogue.RouteDistance(bus, i, j)) / meters_per_minute});
+            result.descriptions.push_back({name_id, span_count});
+
+            if (!bus->is_roundtrip_) {
+                result.edges.push_back({stop_vertices[j] + 1,
+                                        stop_vertices[i],
+                                        static_cast<double>(catalogue.RouteDistance(bus, j, i)) / meters_per_minute});
+                result.descriptions.push_back({name_id, span_count});
             }
         }
     }
+    return result;
+}
+
+void TransportRouter::AddBusLines(
+        const TransportCatalogue &catalogue,
+        const Bus *bus,
+        uint32_t name_id,
+        graph::DirectedWeightedGraph<double> &stops_graph
+        ) {
+    const auto &stops = bus->route_;
+    const size_t stops_count = stops.size();
+    // Расстояния - целые числа в double, поэтому их разности и веса совпадают с весами из MakeBusEdges
+    graph::Line<double> line{{}, {}, {}, settings_.bus_velocity * (100.0 / 6.0)};
+    line.departures.reserve(stops_count);
+    line.arrivals.reserve(stops_count);
+    line.offsets.reserve(stops_count);
+    for (size_t i = 0; i < stops_count; ++i) {
+        const graph::VertexId stop_vertex = stop_ids_.at(stops[i]->name_);
+        line.departures.push_back(stop_vertex + 1);
+        line.arrivals.push_back(stop_vertex);
+        line.offsets.push_back(static_cast<double>(catalogue.RouteDistance(bus, 0, i)));
+    }
+    if (bus->is_roundtrip_) {
+        stops_graph.AddLine(std::move(line));
+        line_name_ids_.push_back(name_id);
+        return;
+    }
+
+    // Обратное направление: остановки с конца, расстояния от последней остановки
+    graph::Line<double> backward_line{{line.departures.rbegin(), line.departures.rend()},
+                                      {line.arrivals.rbegin(), line.arrivals.rend()},
+                                      {},
+                                      line.divisor};
+    backward_line.offsets.reserve(stops_count);
+    for (size_t k = 0; k < stops_count; ++k) {
+        backward_line.offsets.push_back(
+                static_cast<double>(catalogue.RouteDistance(bus, stops_count - 1, stops_count - 1 - k)));
+    }
+    stops_graph.AddLine(std::move(line));
+    line_name_ids_.push_back(name_id);
+    stops_graph.AddLine(std::move(backward_line));
+    line_name_ids_.push_back(name_id);
+}
+
+TransportRouter::MemoryEstimate TransportRouter::EstimateMemory(
+        const TransportRouterSettings &settings,
+        const TransportCatalogue &catalogue
+        ) {
+    MemoryEstimate estimate{};
+    const size_t stops_count = catalogue.GetAllSortedStops().size();
+    estimate.vertex_count = stops_count * 2;
+    // Ребра ожидания и ребра между каждой парой остановок автобуса, как в MakeBusEdges.
+    // Оценка сверху: параллельные ребра отбрасываются уже при построении графа
+    estimate.edge_count = stops_count;
+    size_t line_positions = 0;
+    for (const auto &[bus_name, bus]: catalogue.GetAllSortedBuses()) {
+        const size_t route_size = bus->route_.size();
+        const size_t pairs_count = route_size < 2 ? 0 : route_size * (route_size - 1) / 2;
+        estimate.edge_count += bus->is_roundtrip_ ? pairs_count : pairs_count * 2;
+        line_positions += bus->is_roundtrip_ ? route_size : route_size * 2;
+    }
+
+    // Ребро, исходящая и входящая дуга в CSR и описание ребра
+    const size_t stored_edge_size = sizeof(graph::Edge<double>) + 2 * sizeof(graph::Arc<double>)
+                                    + sizeof(EdgeDescription);
+    if (settings.implicit_bus_edges) {
+        // Хранятся только ребра ожидания. Позиция линии - вершины посадки и прибытия, расстояние
+        // и две записи в индексах исходящих и входящих позиций (номер линии и позиция)
+        estimate.graph = stops_count * stored_edge_size
+                         + line_positions * (2 * sizeof(graph::VertexId) + sizeof(double) + 4 * sizeof(uint32_t))
+                         + estimate.vertex_count * 4 * sizeof(size_t);
+    } else {
+        estimate.graph = estimate.edge_count * stored_edge_size + estimate.vertex_count * 2 * sizeof(size_t);
+    }
+    const size_t cells_count = estimate.vertex_count * estimate.vertex_count;
+    if (settings.fixed_point_weights) {
+        // Таблица с целыми весами и копия графа с целыми весами
+        estimate.all_pairs = cells_count * (sizeof(FixedWeight) + sizeof(graph::EdgeId))
+                             + estimate.edge_count * (sizeof(graph::Edge<FixedWeight>)
+                                                      + 2 * sizeof(graph::Arc<FixedWeight>));
+    } else {
+        estimate.all_pairs = cells_count * (sizeof(double) + sizeof(graph::EdgeId));
+    }
+    estimate.compact_all_pairs = stops_count * stops_count * sizeof(graph::CompactRouter<double>::Cell);
+    estimate.shortest_path_tree = graph::ShortestPathTree<double>::EstimateMemory(estimate.vertex_count);
+    return estimate;
+}
+
+TransportRouterSettings TransportRouterBuilder::ChooseSettings() const {
+    if (memory_budget_ == 0 || is_strategy_set_) {
+        return settings_;
+    }
+    // Меньше этого числа деревьев кэш почти не дает попаданий, и лучше искать по запросу
+    static constexpr size_t MIN_CACHED_TREES = 16;
+    static constexpr double MEGABYTE = 1024.0 * 1024.0;
+
+    TransportRouterSettings settings = settings_;
+    const auto estimate = TransportRouter::EstimateMemory(settings, catalogue_);
+    size_t footprint = estimate.graph;
+    if (estimate.graph + estimate.all_pairs <= memory_budget_) {
+        settings.strategy = RoutingStrategy::AllPairs;
+        footprint += estimate.all_pairs;
+    } else if (estimate.graph + estimate.compact_all_pairs <= memory_budget_) {
+        settings.strategy = RoutingStrategy::CompactAllPairs;
+        footprint += estimate.compact_all_pairs;
+    } else if (estimate.graph + MIN_CACHED_TREES * estimate.shortest_path_tree <= memory_budget_) {
+        settings.strategy = RoutingStrategy::CachedTrees;
+        settings.tree_cache_memory_limit = memory_budget_ - estimate.graph;
+        footprint += settings.tree_cache_memory_limit;
+    } else {
+        settings.strategy = RoutingStrategy::Dijkstra;
+    }
+
+    std::cerr << std::fixed << std::setprecision(1)
+              << "Routing strategy: " << RoutingStrategyName(settings.strategy)
+              << ", estimated memory " << static_cast<double>(footprint) / MEGABYTE
+              << " MB of " << static_cast<double>(memory_budget_) / MEGABYTE
+              << " MB budget (" << estimate.vertex_count << " vertices, " << estimate.edge_count << " edges)";
+    if (footprint > memory_budget_) {
+        std::cerr << ", the graph alone exceeds the budget";
+    }
+    std::cerr << std::endl;
+    return settings;
 }
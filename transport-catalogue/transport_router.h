@@ -1,30 +1,167 @@
 #pragma once
 
 #include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
 
+#include "astar_router.h"
+#include "cached_router.h"
+#include "compact_router.h"
+#include "contraction_hierarchy.h"
+#include "dijkstra_router.h"
+#include "fixed_point.h"
+#include "geo.h"
 #include "graph.h"
+#include "hub_labels.h"
+#include "raptor_router.h"
 #include "router.h"
+#include "router_storage.h"
+#include "source_tree_router.h"
 
 #include "transport_catalogue.h"
 
+// Алгоритм поиска маршрутов
+enum class RoutingStrategy {
+    // Предподсчет всех пар вершин (Флойд-Уоршелл), подходит для небольших сетей
+    AllPairs,
+    // Компактная таблица маршрутов только между остановками: в 6 раз меньше памяти, чем AllPairs
+    CompactAllPairs,
+    // Двунаправленный Дейкстра по запросу, без предподсчета
+    Dijkstra,
+    // A* по запросу с нижней оценкой времени по расстоянию по прямой между остановками
+    AStar,
+    // Деревья кратчайших путей из популярных остановок в LRU-кэше
+    CachedTrees,
+    // Иерархии сжатия: быстрый предподсчет и запросы за миллисекунды на больших сетях
+    ContractionHierarchies,
+    // Метки хабов: запрос - слияние двух коротких списков, памяти намного меньше, чем у таблиц всех пар
+    HubLabels,
+    // Поиск по раундам прямо по маршрутам автобусов, без графа с ребрами для каждой пары остановок
+    Raptor,
+    // Деревья кратчайших путей только из начальных остановок route_origins, построенные заранее.
+    // Из остальных остановок - Dijkstra по запросу
+    SourceTrees
+};
+
 struct TransportRouterSettings {
     uint8_t bus_wait_time;
     double bus_velocity;
+    RoutingStrategy strategy = RoutingStrategy::AllPairs;
+    // Ограничение памяти кэша деревьев для RoutingStrategy::CachedTrees, в байтах
+    size_t tree_cache_memory_limit = 256 * 1024 * 1024;
+    // Ограничение числа пересадок для RoutingStrategy::Raptor
+    size_t max_transfers = RaptorRouter::UNLIMITED_TRANSFERS;
+    // Файл для предподсчитанных таблиц AllPairs и CompactAllPairs, пустой путь - не сохранять
+    std::string router_cache_path{};
+    // Проверять контрольную сумму всего файла таблиц при загрузке. Без проверки запуск не читает таблицы
+    // целиком, а с ней - читает весь файл до первого запроса
+    bool verify_router_cache = false;
+    // Поиск по весам в целых миллисекундах для AllPairs (вдвое меньше таблица весов) и Dijkstra (RadixHeap).
+    // Время в ответах все равно считается по исходным весам. Остальные алгоритмы настройку не используют
+    bool fixed_point_weights = false;
+    // Поездки автобусов - линии графа: ребра между парами остановок порождаются при поиске из расстояний
+    // от начала маршрута, и память на автобус линейна по длине маршрута, а не квадратична.
+    // Параллельные ребра разных автобусов при этом не отбрасываются
+    bool implicit_bus_edges = false;
+    // Начальные остановки будущих запросов маршрутов для RoutingStrategy::SourceTrees
+    std::vector<std::string> route_origins{};
 };
 
+// Название алгоритма, как в routing_settings
+std::string_view RoutingStrategyName(RoutingStrategy strategy);
+
 class TransportRouter final {
 public:
-    using RouteInfo = graph::Router<double>::RouteInfo;
-    using Graph = graph::DirectedWeightedGraph<double>;
+    using RouteInfo = graph::BaseRouter<double>::RouteInfo;
+    using TreeCacheStats = graph::CachedTreeRouter<double>::CacheStats;
 
     explicit TransportRouter(const TransportRouterSettings& settings, const TransportCatalogue &catalogue);
 
+    // Оценка памяти до построения маршрутизатора, в байтах: граф и таблицы разных алгоритмов
+    struct MemoryEstimate {
+        size_t vertex_count;
+        size_t edge_count;
+        size_t graph;
+        size_t all_pairs;
+        size_t compact_all_pairs;
+        size_t shortest_path_tree;
+    };
+
+    [[nodiscard]] static MemoryEstimate EstimateMemory(const TransportRouterSettings &settings,
+                                                       const TransportCatalogue &catalogue);
+
+    // Описание ребра из FindRoute: название остановки (ожидание) или автобуса
+    // и количество пролетов (0 для ожидания)
+    struct EdgeInfo {
+        std::string_view name;
+        size_t span_count;
+    };
+
+    // Маршрут в виде ребер графа, недоступен для RoutingStrategy::Raptor
     [[nodiscard]] std::optional<RouteInfo> FindRoute(std::string_view stop_from, std::string_view stop_to) const;
 
-    // Испольуется для составления отчета и чтобы не городить optional пар
-    [[nodiscard]] Graph GetGraph() const;
+    // Маршрут в виде этапов ожидания и поездок, работает для любого алгоритма
+    [[nodiscard]] std::optional<Itinerary> FindItinerary(std::string_view stop_from, std::string_view stop_to) const;
+
+    struct RouteRequest {
+        std::string_view stop_from;
+        std::string_view stop_to;
+    };
+
+    // Ответы на пачку запросов в исходном порядке. Запросы группируются по начальной остановке,
+    // группы обрабатываются параллельно. Для алгоритмов без предподсчета на группу строится
+    // одно дерево кратчайших путей вместо отдельного поиска на каждый запрос.
+    [[nodiscard]] std::vector<std::optional<Itinerary>> FindItineraries(const std::vector<RouteRequest> &requests) const;
+
+    // Время в пути между всеми парами остановок stops: строка - начальная остановка, столбец - конечная,
+    // nullopt - маршрута нет. Считаются только веса, без маршрутов: для графа - один поиск многие-ко-многим
+    // (корзины для ContractionHierarchies, таблицы для AllPairs), для Raptor - поиск из каждой остановки
+    [[nodiscard]] std::vector<std::vector<std::optional<double>>> FindTimeMatrix(
+            const std::vector<std::string_view> &stops) const;
+
+    // Остановки, до которых из stop_from можно доехать не дольше чем за max_time, с временем в пути,
+    // по возрастанию времени. Один поиск Дейкстры по графу, который останавливается на границе max_time
+    [[nodiscard]] std::vector<ReachableStop> FindReachableStops(std::string_view stop_from, double max_time) const;
+
+    [[nodiscard]] EdgeInfo GetEdgeInfo(graph::EdgeId edge_id) const;
+
+    // Добавляет ребра автобуса, который уже есть в справочнике, и обновляет маршрутизатор:
+    // таблица AllPairs обновляется за O(V^2) на ребро, из кэша деревьев удаляются только затронутые деревья,
+    // Dijkstra ищет по обновленному графу, остальные алгоритмы перестраиваются.
+    // Все остановки автобуса должны быть известны маршрутизатору. Изменение расстояний между
+    // остановками уже добавленных автобусов меняет веса ребер и требует построить TransportRouter заново.
+    // Нельзя вызывать одновременно с поиском маршрутов.
+    void AddBus(const TransportCatalogue &catalogue, std::string_view bus_name);
+
+    // Учитывает расстояния, добавленные в справочник через AddDistance после построения маршрутизатора.
+    // Если расстояния между остановками автобусов только сократились, добавляются более быстрые ребра
+    // этих автобусов и маршрутизатор обновляется, как в AddBus. Если какое-то расстояние выросло,
+    // граф и маршрутизатор строятся заново. Нельзя вызывать одновременно с поиском маршрутов.
+    void UpdateDistances(const TransportCatalogue &catalogue);
+
+    // Строит граф и маршрутизатор заново по справочнику, например после добавления остановок
+    void Rebuild(const TransportCatalogue &catalogue);
+
+    // Счетчики попаданий и промахов кэша деревьев, если используется RoutingStrategy::CachedTrees
+    [[nodiscard]] std::optional<TreeCacheStats> GetTreeCacheStats() const;
 
 private:
+    // Компактное описание ребра: индекс названия в names_ и количество пролетов
+    struct EdgeDescription {
+        uint32_t name_id;
+        uint32_t span_count;
+    };
+
+    // Остановки в порядке обхода кривой Гильберта по координатам: близкие остановки получают
+    // близкие номера вершин, и поиски и строки таблиц реже промахиваются мимо кэша.
+    // При одинаковой клетке порядок - по названию
+    static std::vector<const Stop *> OrderStopsByLocality(const TransportCatalogue &catalogue);
+
+    void Initialize(const TransportCatalogue &catalogue);
+
     void FillGraphStops(const TransportCatalogue &catalogue,
                         graph::VertexId &vertex_id,
                         graph::DirectedWeightedGraph<double> &stops_graph);
@@ -33,11 +170,91 @@ private:
                         graph::VertexId &vertex_id,
                         graph::DirectedWeightedGraph<double> &stops_graph);
 
+    // Ребра одного автобуса вместе с их описаниями
+    struct BusEdges {
+        std::vector<graph::Edge<double>> edges;
+        std::vector<EdgeDescription> descriptions;
+    };
+
+    // Нижняя оценка времени в пути: расстояние по прямой, деленное на наибольшую скорость в сети.
+    // Скорость считается по ребрам графа, потому что расстояния по дорогам в справочнике
+    // могут быть и меньше расстояний по прямой
+    struct GeoLowerBound {
+        std::vector<geo::Coordinates> coordinates;
+        double max_speed;
+
+        double operator()(graph::VertexId from, graph::VertexId to) const;
+    };
+
+    std::unique_ptr<graph::BaseRouter<double>> MakeAStarRouter(const TransportCatalogue &catalogue) const;
+
+    [[nodiscard]] Itinerary MakeItinerary(const std::vector<graph::EdgeId> &edges) const;
+
+    [[nodiscard]] BusEdges MakeBusEdges(const TransportCatalogue &catalogue, const Bus *bus, uint32_t name_id) const;
+
+    // Линии автобуса для settings_.implicit_bus_edges: прямое направление и, если маршрут не кольцевой, обратное
+    void AddBusLines(const TransportCatalogue &catalogue, const Bus *bus, uint32_t name_id,
+                     graph::DirectedWeightedGraph<double> &stops_graph);
+
+    // Описание хранимого ребра или ребра линии
+    [[nodiscard]] EdgeDescription DescribeEdge(graph::EdgeId edge_id) const;
+
+    // Добавляет в замороженный граф ребра или линии автобуса, которые быстрее уже имеющихся, и возвращает их номера
+    std::vector<graph::EdgeId> AddBusEdges(const TransportCatalogue &catalogue, const Bus *bus, uint32_t name_id);
+
+    // Обновляет маршрутизатор после добавления ребер edge_ids в граф
+    void UpdateRouter(const TransportCatalogue &catalogue, const std::vector<graph::EdgeId> &edge_ids);
+
+    // Расстояния автобуса, по которым построены его ребра: между соседними остановками маршрута
+    // в прямом направлении, затем в обратном
+    struct BusDistances {
+        uint32_t name_id;
+        std::vector<size_t> segments;
+    };
+
+    static std::vector<size_t> RouteSegments(const TransportCatalogue &catalogue, const Bus *bus);
+
+    // Из параллельных ребер между одной парой вершин поиску нужно только самое быстрое.
+    // При равном времени остается ребро автобуса с меньшим названием, затем с меньшим числом пролетов.
+    // Ребра результата упорядочены по начальной и конечной вершине
+    [[nodiscard]] BusEdges PruneDominatedEdges(BusEdges bus_edges) const;
+
+    // Есть ли в графе ребро между теми же вершинами, которое не хуже edge по тем же правилам
+    [[nodiscard]] bool IsDominated(const graph::Edge<double> &edge, const EdgeDescription &description) const;
+
+    void BuildRouter(const TransportCatalogue &catalogue);
+
+    // Веса в целых миллисекундах для settings_.fixed_point_weights
+    using FixedWeight = uint32_t;
+    static constexpr double FIXED_POINT_SCALE = 60.0 * 1000.0;
+
+    [[nodiscard]] bool UsesFixedPointWeights() const;
+
+    // Таблицы берутся из settings_.router_cache_path, если файл подходит к графу, иначе строятся и сохраняются
+    template <typename Weight>
+    std::unique_ptr<graph::BaseRouter<Weight>> MakeAllPairsRouter(const graph::DirectedWeightedGraph<Weight> &graph);
+    std::unique_ptr<graph::BaseRouter<double>> MakeCompactRouter();
+
+    // Отпечаток графа и алгоритма: файл таблиц подходит, только если он совпадает
+    [[nodiscard]] uint64_t GraphFingerprint(const std::vector<graph::VertexId> &terminals) const;
+
+    void SaveRouterTables(uint64_t fingerprint, const std::vector<router_storage::Block> &blocks) const;
+
     TransportRouterSettings settings_{};
 
     graph::DirectedWeightedGraph<double> graph_{};
+    // Названия остановок и автобусов ссылаются на строки справочника, который должен пережить маршрутизатор
+    std::vector<std::string_view> names_{};
+    std::vector<EdgeDescription> edge_descriptions_{};
+    // Индекс названия автобуса для каждой линии графа
+    std::vector<uint32_t> line_name_ids_{};
+    std::unordered_map<const Bus *, BusDistances> bus_distances_{};
     std::map<std::string, graph::VertexId> stop_ids_{};
-    std::unique_ptr<graph::Router<double>> router_{};
+    // Отображенный в память файл таблиц должен пережить router_, который на него ссылается
+    std::optional<router_storage::StoredTables> stored_tables_{};
+    std::unique_ptr<graph::BaseRouter<double>> router_{};
+    std::unique_ptr<RaptorRouter> raptor_{};
+    graph::CachedTreeRouter<double> *tree_cache_{};
 
 };
 
@@ -62,12 +279,66 @@ public:
         return *this;
     }
 
+    TransportRouterBuilder &SetRoutingStrategy(RoutingStrategy value) noexcept {
+        settings_.strategy = value;
+        is_strategy_set_ = true;
+        return *this;
+    }
+
+    // Если алгоритм не задан явно, Build выбирает его по оценке памяти: таблицы всех пар,
+    // кэш деревьев или поиск по запросу. 0 - без ограничения, по умолчанию AllPairs
+    TransportRouterBuilder &SetMemoryBudget(size_t bytes) noexcept {
+        memory_budget_ = bytes;
+        return *this;
+    }
+
+    TransportRouterBuilder &SetTreeCacheMemoryLimit(size_t bytes) noexcept {
+        settings_.tree_cache_memory_limit = bytes;
+        return *this;
+    }
+
+    TransportRouterBuilder &SetMaxTransfers(size_t value) noexcept {
+        settings_.max_transfers = value;
+        return *this;
+    }
+
+    TransportRouterBuilder &SetRouterCachePath(std::string path) noexcept {
+        settings_.router_cache_path = std::move(path);
+        return *this;
+    }
+
+    TransportRouterBuilder &SetVerifyRouterCache(bool value) noexcept {
+        settings_.verify_router_cache = value;
+        return *this;
+    }
+
+    TransportRouterBuilder &SetFixedPointWeights(bool value) noexcept {
+        settings_.fixed_point_weights = value;
+        return *this;
+    }
+
+    TransportRouterBuilder &SetImplicitBusEdges(bool value) noexcept {
+        settings_.implicit_bus_edges = value;
+        return *this;
+    }
+
+    // Остановки, из которых будут искаться маршруты, например из заранее прочитанных запросов
+    TransportRouterBuilder &SetRouteOrigins(std::vector<std::string> stops) noexcept {
+        settings_.route_origins = std::move(stops);
+        return *this;
+    }
+
     TransportRouter Build() const noexcept {
-        return TransportRouter{settings_, catalogue_};
+        return TransportRouter{ChooseSettings(), catalogue_};
     }
 
 private:
+    // Настройки с алгоритмом, подходящим под memory_budget_. Выбор и оценка памяти пишутся в std::cerr
+    [[nodiscard]] TransportRouterSettings ChooseSettings() const;
+
     const TransportCatalogue &catalogue_{};
     TransportRouterSettings settings_{};
+    bool is_strategy_set_ = false;
+    size_t memory_budget_ = 0;
 
 };